@@ -0,0 +1,269 @@
+/* indent-tabs-mode: nil -*- */
+/*
+    qore Python module benchmark harness
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*  Runs the benchmark scripts given on the command line and writes the results as JSON
+
+    Each script must provide a function with the following signature:
+        hash<string, code> get_benchmarks()
+
+    Each code value in the hash must accept a single int argument giving the number of operations to execute; the
+    harness calls it once for warm-up and then repeatedly with the given number of iterations, and reports the time
+    per operation.
+*/
+
+#include <qore/Qore.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+struct bench_options {
+    int64 iterations = 10000;
+    int repeat = 5;
+    const char* output = nullptr;
+    const char* filter = nullptr;
+    std::vector<const char*> scripts;
+};
+
+struct bench_result {
+    std::string suite;
+    std::string name;
+    int64 iterations;
+    std::vector<double> ns_per_op;
+};
+
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [options] <script>...\n" \
+        "  -i, --iterations=N   operations per run (default: 10000)\n" \
+        "  -r, --repeat=N       number of timed runs per benchmark (default: 5)\n" \
+        "  -f, --filter=STR     only run benchmarks whose name contains STR\n" \
+        "  -o, --output=FILE    write JSON output to FILE (default: stdout)\n", prog);
+}
+
+const char* get_opt_arg(int argc, char* argv[], int& i, const char* sname, const char* lname) {
+    size_t len = strlen(lname);
+    if (!strncmp(argv[i], lname, len) && argv[i][len] == '=') {
+        return argv[i] + len + 1;
+    }
+    if (!strcmp(argv[i], sname) || !strcmp(argv[i], lname)) {
+        if (i + 1 < argc) {
+            return argv[++i];
+        }
+        fprintf(stderr, "missing argument for option %s\n", argv[i]);
+        exit(1);
+    }
+    return nullptr;
+}
+
+int parse_options(int argc, char* argv[], bench_options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg;
+        if ((arg = get_opt_arg(argc, argv, i, "-i", "--iterations"))) {
+            opts.iterations = strtoll(arg, nullptr, 10);
+        } else if ((arg = get_opt_arg(argc, argv, i, "-r", "--repeat"))) {
+            opts.repeat = atoi(arg);
+        } else if ((arg = get_opt_arg(argc, argv, i, "-f", "--filter"))) {
+            opts.filter = arg;
+        } else if ((arg = get_opt_arg(argc, argv, i, "-o", "--output"))) {
+            opts.output = arg;
+        } else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+            usage(argv[0]);
+            exit(0);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return -1;
+        } else {
+            opts.scripts.push_back(argv[i]);
+        }
+    }
+    if (opts.scripts.empty() || opts.iterations < 1 || opts.repeat < 1) {
+        return -1;
+    }
+    return 0;
+}
+
+std::string get_suite_name(const char* path) {
+    const char* p = strrchr(path, '/');
+    std::string name(p ? p + 1 : path);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) {
+        name.erase(dot);
+    }
+    return name;
+}
+
+// returns the time in nanoseconds for executing the given code with "iters" as the argument
+int run_one(const ResolvedCallReferenceNode* code, int64 iters, double& ns, ExceptionSink& xsink) {
+    ReferenceHolder<QoreListNode> args(new QoreListNode(autoTypeInfo), &xsink);
+    args->push(iters, &xsink);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ValueHolder rv(code->execValue(*args, &xsink), &xsink);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    if (xsink) {
+        return -1;
+    }
+    ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return 0;
+}
+
+int run_script(const bench_options& opts, const char* path, std::vector<bench_result>& results) {
+    ExceptionSink xsink;
+    QoreProgram* pgm = new QoreProgram(PO_NEW_STYLE);
+    std::string suite = get_suite_name(path);
+
+    int rc = 0;
+    pgm->parseFile(path, &xsink);
+    if (!xsink) {
+        ValueHolder bh(pgm->callFunction("get_benchmarks", nullptr, &xsink), &xsink);
+        if (!xsink && bh->getType() != NT_HASH) {
+            xsink.raiseException("BENCH-ERROR", "%s: get_benchmarks() returned type '%s'; expecting 'hash'", path,
+                bh->getFullTypeName());
+        }
+        if (!xsink) {
+            ConstHashIterator i(bh->get<const QoreHashNode>());
+            while (i.next()) {
+                if (opts.filter && !strstr(i.getKey(), opts.filter)) {
+                    continue;
+                }
+                const QoreValue v = i.get();
+                if (v.getType() != NT_FUNCREF && v.getType() != NT_RUNTIME_CLOSURE) {
+                    xsink.raiseException("BENCH-ERROR", "%s: benchmark '%s' has type '%s'; expecting 'code'", path,
+                        i.getKey(), v.getFullTypeName());
+                    break;
+                }
+                const ResolvedCallReferenceNode* code = v.get<const ResolvedCallReferenceNode>();
+
+                bench_result res = {suite, i.getKey(), opts.iterations, {}};
+                fprintf(stderr, "%s.%s: ", suite.c_str(), i.getKey());
+                // warm up
+                double ns;
+                if (run_one(code, std::max((int64)1, opts.iterations / 10), ns, xsink)) {
+                    break;
+                }
+                for (int j = 0; j < opts.repeat; ++j) {
+                    if (run_one(code, opts.iterations, ns, xsink)) {
+                        break;
+                    }
+                    res.ns_per_op.push_back(ns / opts.iterations);
+                }
+                if (xsink) {
+                    break;
+                }
+                std::sort(res.ns_per_op.begin(), res.ns_per_op.end());
+                fprintf(stderr, "%.1f ns/op\n", res.ns_per_op[res.ns_per_op.size() / 2]);
+                results.push_back(res);
+            }
+        }
+    }
+
+    if (xsink) {
+        fprintf(stderr, "\n");
+        xsink.handleExceptions();
+        rc = -1;
+    }
+    pgm->waitForTerminationAndDeref(&xsink);
+    xsink.handleExceptions();
+    return rc;
+}
+
+// writes a JSON string literal with all required characters escaped
+void write_json_string(FILE* fp, const char* str) {
+    fputc('"', fp);
+    for (const unsigned char* p = (const unsigned char*)str; *p; ++p) {
+        switch (*p) {
+            case '"': fputs("\\\"", fp); break;
+            case '\\': fputs("\\\\", fp); break;
+            case '\b': fputs("\\b", fp); break;
+            case '\f': fputs("\\f", fp); break;
+            case '\n': fputs("\\n", fp); break;
+            case '\r': fputs("\\r", fp); break;
+            case '\t': fputs("\\t", fp); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(fp, "\\u%04x", *p);
+                } else {
+                    fputc(*p, fp);
+                }
+                break;
+        }
+    }
+    fputc('"', fp);
+}
+
+void write_json(FILE* fp, const bench_options& opts, const std::vector<bench_result>& results) {
+    fputs("{\n  \"qore_version\": ", fp);
+    write_json_string(fp, qore_version_string);
+    fprintf(fp, ",\n  \"iterations\": %lld,\n  \"repeat\": %d,\n  \"results\": [", (long long)opts.iterations,
+        opts.repeat);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const bench_result& r = results[i];
+        const std::vector<double>& v = r.ns_per_op;
+        double median = v[v.size() / 2];
+        fprintf(fp, "%s\n    {\"suite\": ", i ? "," : "");
+        write_json_string(fp, r.suite.c_str());
+        fputs(", \"name\": ", fp);
+        write_json_string(fp, r.name.c_str());
+        fprintf(fp, ", \"iterations\": %lld, \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, " \
+            "\"max_ns_per_op\": %.2f, \"ops_per_sec\": %.0f}", (long long)r.iterations, median, v.front(), v.back(),
+            median > 0 ? 1000000000.0 / median : 0.0);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+}
+
+int main(int argc, char* argv[]) {
+    bench_options opts;
+    if (parse_options(argc, argv, opts)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    qore_init(QL_MIT);
+
+    std::vector<bench_result> results;
+    int rc = 0;
+    for (const char* path : opts.scripts) {
+        if (run_script(opts, path, results)) {
+            rc = 1;
+        }
+    }
+
+    FILE* fp = opts.output ? fopen(opts.output, "w") : stdout;
+    if (!fp) {
+        fprintf(stderr, "cannot open '%s' for writing: %s\n", opts.output, strerror(errno));
+        rc = 1;
+    } else {
+        write_json(fp, opts, results);
+        if (fp != stdout) {
+            fclose(fp);
+        }
+    }
+
+    qore_cleanup();
+    return rc;
+}
@@ -22,7 +22,10 @@
 
 #include "ModuleNamespace.h"
 
+static PyObject* ModuleNamespace_dir(PyObject* self, PyObject* args);
+
 static PyMethodDef ModuleNamespace_methods[] = {
+    {"__dir__", ModuleNamespace_dir, METH_NOARGS, "ModuleNamespace.__dir__() implementation"},
     {nullptr, nullptr},
 };
 
@@ -118,6 +121,43 @@ PyObject* ModuleNamespace_New(const char* name, const QoreNamespace* ns) {
     return self.release();
 }
 
+// returns a list of all symbol names in the namespace without importing them
+static PyObject* get_symbol_list(ModuleNamespace* mns) {
+    QoreProgram* qpgm = mns->ns->getProgram();
+    ExceptionSink xsink;
+    QoreExternalProgramContextHelper pch(&xsink, qpgm);
+    if (xsink) {
+        QorePythonProgram::getContext()->raisePythonException(xsink);
+        return nullptr;
+    }
+    return QorePythonProgram::getQoreNamespaceSymbolList(*mns->ns);
+}
+
+static PyObject* ModuleNamespace_dir(PyObject* self, PyObject* args) {
+    ModuleNamespace* mns = get_namespace(self);
+    // returns a borrowed reference
+    PyObject* dict = PyModule_GetDict(self);
+    QorePythonReferenceHolder rv(PyDict_Keys(dict));
+    if (!rv) {
+        return nullptr;
+    }
+    if (mns->ns) {
+        QorePythonReferenceHolder names(get_symbol_list(mns));
+        if (!names) {
+            return nullptr;
+        }
+        Py_ssize_t len = PyList_Size(*names);
+        for (Py_ssize_t i = 0; i < len; ++i) {
+            // returns a borrowed reference
+            PyObject* name = PyList_GetItem(*names, i);
+            if (!PyDict_Contains(dict, name) && PyList_Append(*rv, name)) {
+                return nullptr;
+            }
+        }
+    }
+    return rv.release();
+}
+
 static PyObject* ModuleNamespace_getattro(PyObject* self, PyObject* key) {
     // first check if the attribute is defined
     PyObject* attr = PyObject_GenericGetAttr(self, key);
@@ -127,15 +167,29 @@ static PyObject* ModuleNamespace_getattro(PyObject* self, PyObject* key) {
     // now try to resolve it
     assert(PyUnicode_Check(key));
     const char* key_str = PyUnicode_AsUTF8(key);
+    ModuleNamespace* mns = get_namespace(self);
+    if (!mns->ns) {
+        return nullptr;
+    }
+    // "__all__" is calculated from the namespace without importing any symbols
+    if (!strcmp(key_str, "__all__")) {
+        PyErr_Clear();
+        return get_symbol_list(mns);
+    }
     // do not try to look up dunder attributes
     if (key_str[0] == '_' && key_str[1] == '_') {
         return nullptr;
     }
-    ModuleNamespace* mns = get_namespace(self);
     printd(5, "ModuleNamespace_getattro() obj: %p ns: %p (%s) attr: %s: %p\n", self, mns->ns, mns->ns->getName(), key_str, attr);
 
-    QoreProgram* qpgm = mns->ns->getProgram();
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
+    // check for a previous failed lookup; namespaces are identified by path, as namespace objects can be replaced
+    std::string ns_path = mns->ns->getPath();
+    if (qore_python_pgm->isMissingNsAttr(ns_path, key_str)) {
+        return nullptr;
+    }
+
+    QoreProgram* qpgm = mns->ns->getProgram();
     ExceptionSink xsink;
     QoreExternalProgramContextHelper pch(&xsink, qpgm);
     if (xsink) {
@@ -144,18 +198,24 @@ static PyObject* ModuleNamespace_getattro(PyObject* self, PyObject* key) {
         return nullptr;
     }
     CurrentProgramRuntimeExternalParseContextHelper prpch;
-    QoreClass* qc = mns->ns->findLocalClass(key_str);
-    if (!qc) {
-        // try to load the class dynamically
-        qc = mns->ns->findLoadLocalClass(key_str);
-    }
-    printd(5, "ModuleNamespace_getattro() %s.%s qc: %p\n", mns->ns->getName(), key_str, qc);
-    if (!qc) {
-        return nullptr;
-    }
-    PyErr_Clear();
-    if (qc && qore_python_pgm->importQoreClassToPython(self, *qc, mns->ns->getName())) {
+    // save the AttributeError in case the symbol cannot be found
+    PyObject* type, * value, * traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    int rc = qore_python_pgm->importQoreSymbolToPython(self, *mns->ns, key_str);
+    printd(5, "ModuleNamespace_getattro() %s.%s rc: %d\n", mns->ns->getName(), key_str, rc);
+    if (rc) {
+        if (rc > 0) {
+            qore_python_pgm->setMissingNsAttr(ns_path, key_str);
+            PyErr_Restore(type, value, traceback);
+        } else {
+            Py_XDECREF(type);
+            Py_XDECREF(value);
+            Py_XDECREF(traceback);
+        }
         return nullptr;
     }
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
     return PyModule_Type.tp_getattro(self, key);
 }
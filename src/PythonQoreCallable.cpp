@@ -21,6 +21,7 @@
 
 #include "PythonQoreCallable.h"
 #include "QorePythonProgram.h"
+#include "QoreThreadAttachHelper.h"
 
 static int qore_callable_init(PyObject* self, PyObject* args, PyObject* kwds);
 static PyObject* qore_callable_new(PyTypeObject* type, PyObject* args, PyObject* kw);
@@ -142,7 +143,10 @@ PyObject* qore_callable_call(PyQoreCallable* self, PyObject* args, PyObject* kwa
         return nullptr;
     }
 
+    q_attach_thread_to_qore();
+
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getExecutionContext();
+    qore_python_pgm->incStat(QPS_PYTHON_TO_QORE_CALLS);
 
     ExceptionSink xsink;
     ReferenceHolder<QoreListNode> qargs(qore_python_pgm->getQoreListFromTuple(&xsink, args), &xsink);
@@ -23,6 +23,7 @@
 #include "QoreLoader.h"
 #include "QorePythonProgram.h"
 #include "QorePythonStackLocationHelper.h"
+#include "QoreThreadAttachHelper.h"
 
 #include <string.h>
 #include <memory>
@@ -126,6 +127,77 @@ PyTypeObject PythonQoreException_Type = {
 #endif
 };
 
+static PyMethodDef PythonQoreObjectBase_methods[] = {
+    {"__dir__", PythonQoreClass::py_dir, METH_NOARGS, "PythonQoreObjectBase.__dir__() implementation"},
+    {nullptr, nullptr},
+};
+
+static PyMethodDef PythonQoreClassType_methods[] = {
+    {"__dir__", PythonQoreClass::py_type_dir, METH_NOARGS, "PythonQoreClassType.__dir__() implementation"},
+    {nullptr, nullptr},
+};
+
+PyTypeObject PythonQoreClassType_Type = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+#if !defined(__clang__) && __GNUC__ < 8
+    // g++ 5.4.0 does not accept the short-form initialization below :(
+    "PythonQoreClassType",          // tp_name
+    0,                              // tp_basicsize
+    0,                              // tp_itemsize
+    nullptr,                        // tp_dealloc
+    0,                              // tp_vectorcall_offset/
+    0,                              // tp_getattr
+    0,                              // tp_setattr
+    0,                              // tp_as_async
+    nullptr,                        // tp_repr
+    0,                              // tp_as_number
+    0,                              // tp_as_sequence
+    0,                              // tp_as_mapping
+    0,                              // tp_hash
+    0,                              // tp_call
+    0,                              // tp_str
+    PythonQoreClass::py_type_getattro, // tp_getattro
+    0,                              // tp_setattro
+    0,                              // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,             // tp_flags
+    "meta type for Python classes based on Qore classes", // tp_doc
+    0,                              // tp_traverse
+    0,                              // tp_clear
+    0,                              // tp_richcompare
+    0,                              // tp_weaklistoffset
+    0,                              // tp_iter
+    0,                              // tp_iternext
+    PythonQoreClassType_methods,    // tp_methods
+    0,                              // tp_members
+    0,                              // tp_getset
+    &PyType_Type,                   // tp_base
+    0,                              // tp_dict
+    0,                              // tp_descr_get
+    0,                              // tp_descr_set
+    0,                              // tp_dictoffset
+    PythonQoreClass::py_type_init,  // tp_init
+#else
+    .tp_name = "PythonQoreClassType",
+    .tp_getattro = PythonQoreClass::py_type_getattro,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "meta type for Python classes based on Qore classes",
+    .tp_methods = PythonQoreClassType_methods,
+    .tp_base = &PyType_Type,
+    .tp_init = PythonQoreClass::py_type_init,
+#endif
+};
+
+int PythonQoreClass::init() {
+    PythonQoreObjectBase_Type.tp_methods = PythonQoreObjectBase_methods;
+    if (PyType_Ready(&PythonQoreObjectBase_Type) < 0) {
+        return -1;
+    }
+    if (PyType_Ready(&PythonQoreClassType_Type) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
 void PythonQoreClass::py_free(PyQoreObject* self) {
     //printd(5, "PythonQoreClass::py_free() self: %p '%s'\n", self, Py_TYPE(self)->tp_name);
     PyObject_Del(self);
@@ -141,7 +213,8 @@ bool PyQoreObjectType_Check(PyTypeObject* type) {
     return type->tp_dict && PyDict_GetItemString(type->tp_dict, QCLASS_KEY);
 }
 
-PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, PyTypeObject* type, const QoreClass& qcls) {
+PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, PyTypeObject* type, const QoreClass& qcls)
+        : pypgm(pypgm) {
     Py_INCREF((PyObject*)type);
     py_type = type;
     pypgm->insertClass(&qcls, this);
@@ -149,15 +222,86 @@ PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, PyTypeObject* type, c
     // can be deleted afterwards
 }
 
-PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, const char* module_name, const QoreClass& qcls, py_cls_map_t::iterator i) {
-    //printd(5, "PythonQoreClass::PythonQoreClass() %s.%s py_type: %p\n", module_name, qcls.getName(), &py_type);
+#if PY_VERSION_HEX < 0x030C0000
+PyTypeObject* PythonQoreClass::newType(const char* name, const char* doc, PyObject* bases) {
+    const char* cname = strrchr(name, '.');
+    cname = cname ? cname + 1 : name;
+    QorePythonReferenceHolder ht_name(PyUnicode_FromString(cname));
+    if (!ht_name) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder module(PyUnicode_FromStringAndSize(name, cname == name ? 0 : cname - name - 1));
+    if (!module) {
+        return nullptr;
+    }
+
+    // the doc string is freed with PyObject_Free() when the type is deallocated
+    size_t doc_len = strlen(doc) + 1;
+    char* tp_doc = reinterpret_cast<char*>(PyObject_Malloc(doc_len));
+    if (!tp_doc) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+    memcpy(tp_doc, doc, doc_len);
+
+    PyHeapTypeObject* heap_type = reinterpret_cast<PyHeapTypeObject*>(
+        PythonQoreClassType_Type.tp_alloc(&PythonQoreClassType_Type, 0));
+    if (!heap_type) {
+        PyObject_Free(tp_doc);
+        return nullptr;
+    }
+    heap_type->ht_name = ht_name.release();
+    Py_INCREF(heap_type->ht_name);
+    heap_type->ht_qualname = heap_type->ht_name;
+
+    PyTypeObject* type = &heap_type->ht_type;
+    // returns a new reference
+    QorePythonReferenceHolder rv(reinterpret_cast<PyObject*>(type));
+    type->tp_name = name;
+    type->tp_doc = tp_doc;
+    type->tp_basicsize = sizeof(PyQoreObject);
+    type->tp_itemsize = 0;
+    type->tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HEAPTYPE;
+    type->tp_as_async = &heap_type->as_async;
+    type->tp_as_number = &heap_type->as_number;
+    type->tp_as_sequence = &heap_type->as_sequence;
+    type->tp_as_mapping = &heap_type->as_mapping;
+    type->tp_as_buffer = &heap_type->as_buffer;
+    type->tp_dealloc = (destructor)py_dealloc;
+    type->tp_repr = py_repr;
+    type->tp_getattro = py_getattro;
+    type->tp_alloc = PyType_GenericAlloc;
+    type->tp_init = py_init;
+    type->tp_new = py_new;
+    type->tp_free = (freefunc)py_free;
+
+    PyTypeObject* base = bases
+        ? reinterpret_cast<PyTypeObject*>(PyTuple_GET_ITEM(bases, 0))
+        : &PythonQoreObjectBase_Type;
+    Py_INCREF(base);
+    type->tp_base = base;
+    if (bases) {
+        Py_INCREF(bases);
+        type->tp_bases = bases;
+    }
+
+    if (PyType_Ready(type) < 0 || PyDict_SetItemString(type->tp_dict, "__module__", *module)) {
+        return nullptr;
+    }
+    return reinterpret_cast<PyTypeObject*>(rv.release());
+}
+#endif
 
-    name.sprintf("%s.%s", module_name, qcls.getName());
-    const char* namestr = pypgm->saveString(name.c_str());
+PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, const char* module_name, const QoreClass& qcls,
+        py_cls_map_t::iterator i) : pypgm(pypgm) {
+    //printd(5, "PythonQoreClass::PythonQoreClass() %s.%s py_type: %p\n", module_name, qcls.getName(), &py_type);
 
-    doc.sprintf("Python wrapper class for Qore class %s", qcls.getName());
-    const char* docstr = pypgm->saveString(doc.c_str());
+    // the type name and doc string must remain valid for the lifetime of the type
+    name = pypgm->saveString(QoreStringMaker("%s.%s", module_name, qcls.getName()).c_str());
+    const char* docstr = pypgm->saveString(QoreStringMaker("Python wrapper class for Qore class %s",
+        qcls.getName()).c_str());
 
+#if PY_VERSION_HEX >= 0x030C0000
     PyType_Slot slots[] = {
         {Py_tp_doc, (void*)docstr},
         {Py_tp_dealloc, (void*)PythonQoreClass::py_dealloc},
@@ -172,18 +316,17 @@ PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, const char* module_na
     };
 
     PyType_Spec spec = {
-        .name = namestr,
+        .name = name,
         .basicsize = sizeof(PyQoreObject),
         .itemsize = 0,
         .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
         .slots = slots,
     };
-
-    clsset_t cls_set;
+#endif
 
     // get single base class - Python and Qore's multiple inheritance models are not compatible
     // we can only set a single class for the Python base class, so if there are multiple
-    // base classes, then we populate methods instead directly
+    // base classes, then methods from the other classes are added directly
     QorePythonReferenceHolder bases;
     {
         PythonQoreClass* base_cls = nullptr;
@@ -194,7 +337,6 @@ PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, const char* module_na
             }
 
             base_cls = pypgm->findCreatePythonClass(ci.getParentClass(), module_name);
-            cls_set.insert(&ci.getParentClass());
             bases = PyTuple_New(1);
             PyObject* py_base_cls = reinterpret_cast<PyObject*>(base_cls->getPythonType());
             Py_INCREF(py_base_cls);
@@ -203,60 +345,57 @@ PythonQoreClass::PythonQoreClass(QorePythonProgram* pypgm, const char* module_na
         }
     }
 
-    py_type = bases
-        ? reinterpret_cast<PyTypeObject*>(PyType_FromSpecWithBases(&spec, *bases))
-        : reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&spec));
+    // methods and constants are added to the type dictionary on first access by the meta type
+#if PY_VERSION_HEX >= 0x030C0000
+    py_type = reinterpret_cast<PyTypeObject*>(PyType_FromMetaclass(&PythonQoreClassType_Type, nullptr, &spec,
+        *bases));
+#else
+    py_type = newType(name, docstr, *bases);
+#endif
     //printd(5, "PythonQoreClass::PythonQoreClass() %s py_type: %p\n", qcls.getName(), py_type);
 
     assert(py_type);
     assert(py_type->tp_dict);
+    assert(Py_TYPE(py_type) == &PythonQoreClassType_Type);
 
-    // set of normal method names
-    cstrset_t meth_set;
-
+    this->qcls = &qcls;
     pypgm->insertClass(i, &qcls, this);
 
-    // setup class
-    populateClass(pypgm, qcls, cls_set, meth_set);
-
-    // add normal methods
-    for (size_t i = 0; i < py_normal_meth_vec.size(); ++i) {
-        PyMethodDef& md = py_normal_meth_vec[i];
-        QorePythonReferenceHolder method_capsule(py_normal_meth_obj_vec[i].release());
-        QorePythonReferenceHolder func(PyCFunction_New(&md, *method_capsule));
-        QorePythonReferenceHolder meth(PyInstanceMethod_New(*func));
-        assert(meth);
-        const QoreMethod* m = reinterpret_cast<const QoreMethod*>(PyCapsule_GetPointer(*method_capsule, nullptr));
-        PyDict_SetItemString(py_type->tp_dict, m->getName(), *meth);
-    }
-    py_normal_meth_obj_vec.clear();
-
-    // add static methods
-    for (size_t i = 0; i < py_static_meth_vec.size(); ++i) {
-        PyMethodDef& md = py_static_meth_vec[i];
-        QorePythonReferenceHolder method_capsule(py_static_meth_obj_vec[i].release());
-        QorePythonReferenceHolder func(PyCFunction_New(&md, *method_capsule));
-        QorePythonReferenceHolder meth(PyStaticMethod_New(*func));
-        assert(meth);
-        const QoreMethod* m = reinterpret_cast<const QoreMethod*>(PyCapsule_GetPointer(*method_capsule, nullptr));
-        PyDict_SetItemString(py_type->tp_dict, m->getName(), *meth);
-    }
-    py_static_meth_obj_vec.clear();
-
     // add Qore class to type dictionary
     QorePythonReferenceHolder qore_class(PyCapsule_New((void*)&qcls, nullptr, nullptr));
+    PyCapsule_SetContext(*qore_class, this);
     PyDict_SetItemString(py_type->tp_dict, QCLASS_KEY, *qore_class);
 }
 
 PythonQoreClass::~PythonQoreClass() {
-    printd(5, "PythonQoreClass::~PythonQoreClass() this: %p '%s'\n", this, name.c_str());
+    printd(5, "PythonQoreClass::~PythonQoreClass() this: %p '%s'\n", this, name);
     Py_DECREF(py_type);
 }
 
-void PythonQoreClass::populateClass(QorePythonProgram* pypgm, const QoreClass& qcls, clsset_t& cls_set,
-        cstrset_t& meth_set, bool skip_first) {
+void PythonQoreClass::initAttrMap() {
+    assert(!attr_map_init);
+    attr_map_init = true;
+
+    clsset_t cls_set;
+    // the first accessible parent class is the Python base class
+    {
+        QoreParentClassIterator ci(*qcls);
+        while (ci.next()) {
+            if (ci.getAccess() > Private) {
+                continue;
+            }
+            cls_set.insert(&ci.getParentClass());
+            break;
+        }
+    }
+
+    populateClass(*qcls, cls_set);
+    pending = attr_map.size();
+}
+
+void PythonQoreClass::populateClass(const QoreClass& qcls, clsset_t& cls_set, bool skip_first) {
     //printd(5, "PythonQoreClass::populateClass() cls: %s cs: %d ms: %d\n", qcls.getName(), (int)cls_set.size(),
-    //  (int)meth_set.size());
+    //  (int)attr_map.size());
 
     {
         QoreMethodIterator i(qcls);
@@ -268,13 +407,11 @@ void PythonQoreClass::populateClass(QorePythonProgram* pypgm, const QoreClass& q
 
             //printd(5, "PythonQoreClass::populateClass() adding %s -> %s::%s()\n", name.c_str(), qcls.getName(),
             //  m->getName());
-            cstrset_t::iterator mi = meth_set.lower_bound(m->getName());
-            if (mi == meth_set.end() || strcmp(*mi, m->getName())) {
-                meth_set.insert(mi, m->getName());
-                QoreStringMaker mdoc("Python wrapper for Qore class method %s::%s()", qcls.getName(), m->getName());
-                const char* mdocstr = pypgm->saveString(mdoc.c_str());
-                py_normal_meth_vec.push_back({m->getName(), (PyCFunction)exec_qore_method, METH_VARARGS, mdocstr});
-                py_normal_meth_obj_vec.push_back(PyCapsule_New((void*)m, nullptr, nullptr));
+            attr_map_t::iterator mi = attr_map.lower_bound(m->getName());
+            if (mi == attr_map.end() || strcmp(mi->first, m->getName())) {
+                lazy_attr_t attr;
+                attr.m = m;
+                attr_map.insert(mi, attr_map_t::value_type(m->getName(), attr));
             }
         }
     }
@@ -297,20 +434,16 @@ void PythonQoreClass::populateClass(QorePythonProgram* pypgm, const QoreClass& q
 
             //printd(5, "PythonQoreClass::populateClass() adding %s -> static %s::%s()\n", name.c_str(),
             //  qcls.getName(), m->getName());
-            cstrset_t::iterator mi = meth_set.lower_bound(m->getName());
-            if (mi == meth_set.end() || strcmp(*mi, m->getName())) {
-                meth_set.insert(mi, m->getName());
-                QoreStringMaker mdoc("Python wrapper for Qore static class method %s::%s()", qcls.getName(),
-                    m->getName());
-                const char* mdocstr = pypgm->saveString(mdoc.c_str());
-                py_static_meth_vec.push_back({m->getName(), (PyCFunction)exec_qore_static_method, METH_VARARGS,
-                    mdocstr});
-                py_static_meth_obj_vec.push_back(PyCapsule_New((void*)m, nullptr, nullptr));
+            attr_map_t::iterator mi = attr_map.lower_bound(m->getName());
+            if (mi == attr_map.end() || strcmp(mi->first, m->getName())) {
+                lazy_attr_t attr;
+                attr.m = m;
+                attr.is_static = true;
+                attr_map.insert(mi, attr_map_t::value_type(m->getName(), attr));
             }
         }
     }
 
-    ExceptionSink xsink;
     {
         QoreClassConstantIterator i(qcls);
         while (i.next()) {
@@ -318,16 +451,11 @@ void PythonQoreClass::populateClass(QorePythonProgram* pypgm, const QoreClass& q
             if (c.getAccess() > Private) {
                 continue;
             }
-            cstrset_t::iterator mi = meth_set.lower_bound(c.getName());
-            if (mi == meth_set.end() || strcmp(*mi, c.getName())) {
-                meth_set.insert(mi, c.getName());
-                ValueHolder qoreval(c.getReferencedValue(), &xsink);
-                QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
-                QorePythonReferenceHolder val(qore_python_pgm->getPythonValue(*qoreval, &xsink));
-                if (!xsink) {
-                    assert(val);
-                    PyDict_SetItemString(py_type->tp_dict, c.getName(), *val);
-                }
+            attr_map_t::iterator mi = attr_map.lower_bound(c.getName());
+            if (mi == attr_map.end() || strcmp(mi->first, c.getName())) {
+                lazy_attr_t attr;
+                attr.c = &c;
+                attr_map.insert(mi, attr_map_t::value_type(c.getName(), attr));
             }
         }
     }
@@ -354,8 +482,128 @@ void PythonQoreClass::populateClass(QorePythonProgram* pypgm, const QoreClass& q
         }
         //printd(5, "PythonQoreClass::populateClass() %s parent <- %s\n", qcls.getName(), parent_cls.getName());
         cls_set.insert(i, &parent_cls);
-        populateClass(pypgm, parent_cls, cls_set, meth_set, false);
+        populateClass(parent_cls, cls_set, false);
+    }
+}
+
+int PythonQoreClass::resolveAttr(const char* attr) {
+    if (!attr_map_init) {
+        initAttrMap();
+    }
+    if (!pending) {
+        return 0;
+    }
+    attr_map_t::iterator i = attr_map.find(attr);
+    if (i == attr_map.end() || i->second.resolved) {
+        return 0;
+    }
+    i->second.resolved = true;
+    --pending;
+
+    QorePythonReferenceHolder val;
+    if (i->second.m) {
+        const QoreMethod* m = i->second.m;
+        QoreStringMaker mdoc("Python wrapper for Qore %sclass method %s::%s()", i->second.is_static ? "static " : "",
+            m->getClassName(), m->getName());
+        // the method definition must remain valid for the lifetime of the function object, so it is allocated in the
+        // arena of the program that owns the type and not in the arena of the calling program
+        PyMethodDef* def = pypgm->getArena().create<PyMethodDef>();
+        *def = {m->getName(), i->second.is_static
+            ? (PyCFunction)exec_qore_static_method
+            : (PyCFunction)exec_qore_method, METH_VARARGS, pypgm->saveString(mdoc.c_str())};
+
+        QorePythonReferenceHolder method_capsule(PyCapsule_New((void*)m, nullptr, nullptr));
+        QorePythonReferenceHolder func(PyCFunction_New(def, *method_capsule));
+        val = i->second.is_static ? PyStaticMethod_New(*func) : PyInstanceMethod_New(*func);
+    } else {
+        assert(i->second.c);
+        ExceptionSink xsink;
+        ValueHolder qoreval(i->second.c->getReferencedValue(), &xsink);
+        QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
+        if (!xsink) {
+            val = qore_python_pgm->getPythonValue(*qoreval, &xsink);
+        }
+        if (xsink) {
+            qore_python_pgm->raisePythonException(xsink);
+            return -1;
+        }
+    }
+    if (!val || PyDict_SetItemString(py_type->tp_dict, i->first, *val)) {
+        return -1;
+    }
+    // the type dictionary was modified directly; invalidate the type's attribute cache
+    PyType_Modified(py_type);
+    return 1;
+}
+
+int PythonQoreClass::resolveAll() {
+    if (!attr_map_init) {
+        initAttrMap();
+    }
+    for (attr_map_t::iterator i = attr_map.begin(), e = attr_map.end(); pending && i != e; ++i) {
+        if (!i->second.resolved && resolveAttr(i->first) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+PythonQoreClass* PythonQoreClass::getPythonQoreClass(PyTypeObject* type) {
+    if (!type->tp_dict) {
+        return nullptr;
+    }
+    // returns a borrowed reference
+    PyObject* obj = PyDict_GetItemString(type->tp_dict, QCLASS_KEY);
+    if (!obj || !PyCapsule_CheckExact(obj)) {
+        return nullptr;
+    }
+    return reinterpret_cast<PythonQoreClass*>(PyCapsule_GetContext(obj));
+}
+
+int PythonQoreClass::resolveTypeAttr(PyTypeObject* type, PyObject* attr) {
+    PyObject* mro = type->tp_mro;
+    if (!mro) {
+        return 0;
+    }
+    const char* attr_str = nullptr;
+    Py_ssize_t len = PyTuple_GET_SIZE(mro);
+    for (Py_ssize_t i = 0; i < len; ++i) {
+        PyTypeObject* t = reinterpret_cast<PyTypeObject*>(PyTuple_GET_ITEM(mro, i));
+        // stop at the first class that already has the attribute
+        if (t->tp_dict && PyDict_GetItem(t->tp_dict, attr)) {
+            return 0;
+        }
+        PythonQoreClass* pqc = getPythonQoreClass(t);
+        if (!pqc || (pqc->attr_map_init && !pqc->pending)) {
+            continue;
+        }
+        if (!attr_str) {
+            attr_str = PyUnicode_AsUTF8(attr);
+            if (!attr_str) {
+                return -1;
+            }
+        }
+        int rc = pqc->resolveAttr(attr_str);
+        if (rc) {
+            return rc < 0 ? -1 : 0;
+        }
     }
+    return 0;
+}
+
+int PythonQoreClass::resolveTypeAll(PyTypeObject* type) {
+    PyObject* mro = type->tp_mro;
+    if (!mro) {
+        return 0;
+    }
+    Py_ssize_t len = PyTuple_GET_SIZE(mro);
+    for (Py_ssize_t i = 0; i < len; ++i) {
+        PythonQoreClass* pqc = getPythonQoreClass(reinterpret_cast<PyTypeObject*>(PyTuple_GET_ITEM(mro, i)));
+        if (pqc && pqc->resolveAll()) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
 PyObject* PythonQoreClass::wrap(QoreObject* obj) {
@@ -374,7 +622,7 @@ PyObject* PythonQoreClass::wrap(QoreObject* obj) {
 }
 
 PyObject* PythonQoreClass::exec_qore_method(PyObject* method_capsule, PyObject* args) {
-    QoreForeignThreadHelper qfth;
+    q_attach_thread_to_qore();
 
     // get method
     const QoreMethod* m = reinterpret_cast<const QoreMethod*>(PyCapsule_GetPointer(method_capsule, nullptr));
@@ -428,10 +676,17 @@ PyObject* PythonQoreClass::exec_qore_method(PyObject* method_capsule, PyObject*
             pgm = qore_python_pgm->getQoreProgram();
         }
 
+        qore_python_pgm->incStat(QPS_PYTHON_TO_QORE_CALLS);
+        QorePythonGilSiteHelper gsh(m->getClassName(), m->getName());
         QorePythonHelper qph(qore_python_pgm);
+        QorePythonProfileHelper proh(qore_python_pgm->getProfiler(), m->getClassName(), m->getName());
         QoreExternalProgramContextHelper pch(&xsink, pgm);
         if (!xsink) {
-            ReferenceHolder<QoreListNode> qargs(qore_python_pgm->getQoreListFromTuple(&xsink, args, 1), &xsink);
+            ReferenceHolder<QoreListNode> qargs(&xsink);
+            {
+                QorePythonProfileConvHelper pcvh;
+                qargs = qore_python_pgm->getQoreListFromTuple(&xsink, args, 1);
+            }
             if (!xsink) {
                 ValueHolder rv(&xsink);
                 {
@@ -442,6 +697,7 @@ PyObject* PythonQoreClass::exec_qore_method(PyObject* method_capsule, PyObject*
                     rv = obj->evalMethod(*m, *qargs, &xsink);
                 }
                 if (!xsink) {
+                    QorePythonProfileConvHelper pcvh;
                     QorePythonReferenceHolder py_rv(qore_python_pgm->getPythonValue(*rv, &xsink));
                     if (!xsink) {
                         assert(py_rv);
@@ -460,7 +716,7 @@ PyObject* PythonQoreClass::exec_qore_method(PyObject* method_capsule, PyObject*
 
 PyObject* PythonQoreClass::exec_qore_static_method(PyObject* method_capsule, PyObject* args) {
     printd(5, "exec_qore_static_method() args: %p\n", args);
-    QoreForeignThreadHelper qfth;
+    q_attach_thread_to_qore();
 
     // get method
     const QoreMethod* m = reinterpret_cast<const QoreMethod*>(PyCapsule_GetPointer(method_capsule, nullptr));
@@ -487,10 +743,17 @@ PyObject* PythonQoreClass::exec_qore_static_method(const QoreMethod& m, PyObject
             pgm = qore_python_pgm->getQoreProgram();
         }
 
+        qore_python_pgm->incStat(QPS_PYTHON_TO_QORE_CALLS);
+        QorePythonGilSiteHelper gsh(m.getClassName(), m.getName());
         QorePythonHelper qph(qore_python_pgm);
+        QorePythonProfileHelper proh(qore_python_pgm->getProfiler(), m.getClassName(), m.getName());
         QoreExternalProgramContextHelper pch(&xsink, pgm);
         if (!xsink) {
-            ReferenceHolder<QoreListNode> qargs(qore_python_pgm->getQoreListFromTuple(&xsink, args, offset), &xsink);
+            ReferenceHolder<QoreListNode> qargs(&xsink);
+            {
+                QorePythonProfileConvHelper pcvh;
+                qargs = qore_python_pgm->getQoreListFromTuple(&xsink, args, offset);
+            }
             if (!xsink) {
                 ValueHolder rv(&xsink);
                 {
@@ -501,6 +764,7 @@ PyObject* PythonQoreClass::exec_qore_static_method(const QoreMethod& m, PyObject
                     rv = QoreObject::evalStaticMethod(m, m.getClass(), *qargs, &xsink);
                 }
                 if (!xsink) {
+                    QorePythonProfileConvHelper pcvh;
                     QorePythonReferenceHolder py_rv(qore_python_pgm->getPythonValue(*rv, &xsink));
                     if (!xsink) {
                         assert(py_rv);
@@ -524,6 +788,8 @@ int PythonQoreClass::py_init(PyObject* self, PyObject* args, PyObject* kwds) {
     //printd(5, "PythonQoreClass::py_init() self: %p '%s' args: %p (%d: %s) kwds: %p\n", self, Py_TYPE(self)->tp_name,
     //  args, (int)PyTuple_Size(args), PyUnicode_AsUTF8(*argstr), kwds);
 
+    q_attach_thread_to_qore();
+
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getExecutionContext();
 
     ExceptionSink xsink;
@@ -594,6 +860,7 @@ int PythonQoreClass::newQoreObject(ExceptionSink& xsink, PyQoreObject* pyself, Q
         const QoreClass* qcls, QorePythonProgram* qore_python_pgm) {
     qobj->tRef();
     pyself->qobj = qobj;
+    qore_python_pgm->incStat(QPS_WRAPPERS_CREATED);
 
     if (qcls) {
         // add private data for python class
@@ -612,6 +879,10 @@ int PythonQoreClass::newQoreObject(ExceptionSink& xsink, PyQoreObject* pyself, Q
 }
 
 PyObject* PythonQoreClass::py_getattro(PyObject* self, PyObject* attr) {
+    // add any lazy method or constant to the type dictionary before the normal lookup
+    if (PyUnicode_Check(attr) && resolveTypeAttr(Py_TYPE(self), attr)) {
+        return nullptr;
+    }
     // first try to get python attribute
     PyObject* pyrv = PyObject_GenericGetAttr(self, attr);
     if (pyrv) {
@@ -635,6 +906,7 @@ PyObject* PythonQoreClass::py_getattro(PyObject* self, PyObject* attr) {
         return Py_None;
     }
     //printd(5, "PythonQoreClass::py_getattro() obj %p %s.%s\n", obj, qcls->getName(), member);
+    q_attach_thread_to_qore();
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getExecutionContext();
     QoreExternalProgramContextHelper pch(&xsink, qore_python_pgm->getQoreProgram());
     if (!xsink) {
@@ -659,6 +931,48 @@ PyObject* PythonQoreClass::py_getattro(PyObject* self, PyObject* attr) {
     return nullptr;
 }
 
+PyObject* PythonQoreClass::py_dir(PyObject* self, PyObject* args) {
+    if (resolveTypeAll(Py_TYPE(self))) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder dir(PyObject_GetAttrString(reinterpret_cast<PyObject*>(&PyBaseObject_Type), "__dir__"));
+    if (!dir) {
+        return nullptr;
+    }
+    return PyObject_CallFunctionObjArgs(*dir, self, nullptr);
+}
+
+int PythonQoreClass::py_type_init(PyObject* self, PyObject* args, PyObject* kwds) {
+    if (PyType_Type.tp_init(self, args, kwds) < 0) {
+        return -1;
+    }
+    // super() looks up attributes directly in the type dictionaries, so all lazy attributes of the Qore base classes
+    // are resolved when a Python subclass is created; this is done by the meta type, so it cannot be bypassed by an
+    // __init_subclass__() override
+    assert(PyType_Check(self));
+    return resolveTypeAll(reinterpret_cast<PyTypeObject*>(self)) ? -1 : 0;
+}
+
+PyObject* PythonQoreClass::py_type_getattro(PyObject* self, PyObject* attr) {
+    assert(PyType_Check(self));
+    if (PyUnicode_Check(attr) && resolveTypeAttr(reinterpret_cast<PyTypeObject*>(self), attr)) {
+        return nullptr;
+    }
+    return PyType_Type.tp_getattro(self, attr);
+}
+
+PyObject* PythonQoreClass::py_type_dir(PyObject* self, PyObject* args) {
+    assert(PyType_Check(self));
+    if (resolveTypeAll(reinterpret_cast<PyTypeObject*>(self))) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder dir(PyObject_GetAttrString(reinterpret_cast<PyObject*>(&PyType_Type), "__dir__"));
+    if (!dir) {
+        return nullptr;
+    }
+    return PyObject_CallFunctionObjArgs(*dir, self, nullptr);
+}
+
 const QoreClass* PythonQoreClass::findQoreClass(PyObject* self) {
     PyTypeObject* type = Py_TYPE(self);
     // get base Qore class
@@ -25,7 +25,7 @@
 
 #include "python-module.h"
 
-#include <vector>
+#include <map>
 
 // qore object type
 struct PyQoreObject {
@@ -54,25 +54,81 @@ public:
 
     DLLLOCAL static const QoreClass* getQoreClass(PyTypeObject* type);
 
+    //! initializes the base and meta types for Python classes based on Qore classes
+    DLLLOCAL static int init();
+
+    // base type methods
+    DLLLOCAL static PyObject* py_dir(PyObject* self, PyObject* args);
+
+    // meta type methods
+    DLLLOCAL static int py_type_init(PyObject* self, PyObject* args, PyObject* kwds);
+    DLLLOCAL static PyObject* py_type_getattro(PyObject* self, PyObject* attr);
+    DLLLOCAL static PyObject* py_type_dir(PyObject* self, PyObject* args);
+
 private:
-    QoreString name;
-    QoreString doc;
-
-    typedef std::vector<PyMethodDef> py_meth_vec_t;
-    py_meth_vec_t py_normal_meth_vec;
-    py_meth_vec_t py_static_meth_vec;
-    typedef std::vector<QoreString> strvec_t;
-    strvec_t strvec;
-    typedef std::vector<QorePythonReferenceHolder> py_obj_vec_t;
-    py_obj_vec_t py_normal_meth_obj_vec;
-    py_obj_vec_t py_static_meth_obj_vec;
-    typedef std::set<const char*, ltstr> cstrset_t;
+    //! the program that owns this object; lazy method definitions are allocated in its arena
+    QorePythonProgram* pypgm;
+
+    //! the Python type name; owned by the program's arena
+    const char* name = "";
+
+    //! a method or constant added to the type dictionary on first access
+    struct lazy_attr_t {
+        const QoreMethod* m = nullptr;
+        const QoreExternalConstant* c = nullptr;
+        bool is_static = false;
+        bool resolved = false;
+    };
+    //! map of attribute names to lazy attributes; names are owned by the Qore class
+    typedef std::map<const char*, lazy_attr_t, ltstr> attr_map_t;
+    attr_map_t attr_map;
+    //! number of unresolved attributes in attr_map
+    size_t pending = 0;
+    //! true once attr_map has been populated
+    bool attr_map_init = false;
+
     typedef std::set<const QoreClass*> clsset_t;
 
+    const QoreClass* qcls = nullptr;
     PyTypeObject* py_type;
 
-    DLLLOCAL void populateClass(QorePythonProgram* pypgm, const QoreClass& qcls, clsset_t& cls_set,
-        cstrset_t& meth_set, bool skip_first = true);
+    //! builds the attribute map on first use
+    DLLLOCAL void initAttrMap();
+
+    DLLLOCAL void populateClass(const QoreClass& qcls, clsset_t& cls_set, bool skip_first = true);
+
+    //! adds the given attribute to the type dictionary if it is a lazy attribute of this class
+    /** @return 1 if added, 0 if not a lazy attribute or already added, -1 on error (Python exception raised)
+    */
+    DLLLOCAL int resolveAttr(const char* attr);
+
+    //! adds all lazy attributes to the type dictionary; returns -1 on error (Python exception raised)
+    DLLLOCAL int resolveAll();
+
+    //! returns the PythonQoreClass for a type created from a Qore class, nullptr if none
+    DLLLOCAL static PythonQoreClass* getPythonQoreClass(PyTypeObject* type);
+
+    //! resolves the given lazy attribute in the first class in the type's MRO that declares it
+    /** @return 0 for OK, -1 on error (Python exception raised)
+    */
+    DLLLOCAL static int resolveTypeAttr(PyTypeObject* type, PyObject* attr);
+
+    //! resolves all lazy attributes in the type's MRO; returns -1 on error (Python exception raised)
+    DLLLOCAL static int resolveTypeAll(PyTypeObject* type);
+
+#if PY_VERSION_HEX < 0x030C0000
+    //! creates a heap type with the meta type for Python classes based on Qore classes
+    /** PyType_FromMetaclass() is only available with Python 3.12+, so the type object is allocated from the meta
+        type and initialized with PyType_Ready()
+
+        @param name the full type name including the module name; must remain valid for the lifetime of the type
+        @param doc the doc string; copied to the type
+        @param bases the base class tuple; if nullptr, PythonQoreObjectBase_Type is the base class
+
+        @return a new reference to the type, or nullptr if an error occurred (Python exception raised)
+    */
+    DLLLOCAL static PyTypeObject* newType(const char* name, const char* doc, PyObject* bases);
+#endif
 
     DLLLOCAL static int newQoreObject(ExceptionSink& xsink, PyQoreObject* pyself, QoreObject* qobj,
         const QoreClass* qcls, QorePythonProgram* qore_python_pgm);
@@ -121,4 +177,6 @@ DLLLOCAL bool PyQoreObjectType_Check(PyTypeObject* type);
 
 DLLLOCAL extern PyTypeObject PythonQoreException_Type;
 
+DLLLOCAL extern PyTypeObject PythonQoreClassType_Type;
+
 #endif
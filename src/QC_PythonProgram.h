@@ -35,6 +35,10 @@
 
 #include "python-module.h"
 #include "QorePythonProgram.h"
+#include "QoreModuleCodeCache.h"
+#include "QorePythonReaper.h"
+#include "QorePythonInterpreterConfig.h"
+#include "QorePythonFork.h"
 
 DLLLOCAL extern qore_classid_t CID_PYTHONPROGRAM;
 DLLLOCAL extern QoreClass* QC_PYTHONPROGRAM;
@@ -23,11 +23,14 @@
 #include "QoreMetaPathFinder.h"
 #include "QorePythonProgram.h"
 #include "PythonQoreClass.h"
+#include "ModuleNamespace.h"
 
 #include <memory>
 
 QorePythonManualReferenceHolder QoreLoader::loader_cls;
 QorePythonManualReferenceHolder QoreLoader::loader;
+QoreLoader::mod_reexport_map_t QoreLoader::mod_reexport_map;
+QoreThreadLock QoreLoader::mod_reexport_lck;
 
 static PyMethodDef QoreLoader_methods[] = {
     {"create_module", QoreLoader::create_module, METH_VARARGS, "QoreLoader.create_module() implementation"},
@@ -128,8 +131,43 @@ PyObject* QoreLoader::repr(PyObject* obj) {
 
 // class method functions
 PyObject* QoreLoader::create_module(PyObject* self, PyObject* args) {
-    Py_INCREF(Py_None);
-    return Py_None;
+    if (!args || !PyTuple_Check(args) || !PyTuple_Size(args)) {
+        PyErr_SetString(PyExc_ValueError, "missing ModuleSpec arg to 'QoreLoader.create_module()'");
+        return nullptr;
+    }
+    // returns a borrowed reference
+    PyObject* spec = PyTuple_GetItem(args, 0);
+
+    // get name
+    QorePythonReferenceHolder name(PyObject_GetAttrString(spec, "name"));
+    if (!name || !PyUnicode_Check(*name)) {
+        PyErr_SetString(PyExc_ValueError, "ModuleSpec has no 'name' attribute");
+        return nullptr;
+    }
+    const char* name_str = PyUnicode_AsUTF8(*name);
+
+    // return modules for subnamespaces already created on demand
+    // returns a borrowed reference
+    PyObject* mod = PyDict_GetItemString(PyImport_GetModuleDict(), name_str);
+    if (mod && ModuleNamespace_Check(mod)) {
+        Py_INCREF(mod);
+        return mod;
+    }
+
+    QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
+    QoreProgram* mod_pgm = qore_python_pgm->getQoreProgram();
+    const QoreNamespace* ns = getNamespaceForModule(name_str, mod_pgm);
+    if (!ns) {
+        // use the default module creation semantics; exec_module() will raise an error
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    // symbols are imported on demand when accessed
+    printd(5, "QoreLoader::create_module() '%s' ns: %s\n", name_str, ns->getName());
+    // the module is visible to all programs in a shared interpreter
+    qore_python_pgm->pinQoreProgram();
+    return qore_python_pgm->newModule(name_str, ns);
 }
 
 PyObject* QoreLoader::exec_module(PyObject* self, PyObject* args) {
@@ -157,26 +195,21 @@ PyObject* QoreLoader::exec_module(PyObject* self, PyObject* args) {
     QoreProgram* mod_pgm = qore_python_pgm->getQoreProgram();
     printd(5, "QoreLoader::exec_module() qore_python_pgm: %p mod pgm: %p\n", qore_python_pgm, mod_pgm);
 
-    // get root namespace
-    const QoreNamespace* ns;
-    if (!strcmp(name_str, "qore")) {
-        ns = mod_pgm->getQoreNS();
-    } else {
-        assert(!strncmp(name_str, "qore.", 5));
-        name_str += 5;
-        if (strchr(name_str, '.')) {
-            ns = nullptr;
-        } else {
-            if (!strcmp(name_str, "__root__")) {
-                ns = mod_pgm->getRootNS();
-            } else {
-                ns = getModuleRootNs(name_str, mod_pgm);
-            }
-        }
+    // modules created by create_module() import symbols on demand
+    if (ModuleNamespace_Check(mod)) {
+        Py_INCREF(Py_None);
+        return Py_None;
     }
 
+    // get root namespace
+    const QoreNamespace* ns = getNamespaceForModule(name_str, mod_pgm);
     if (ns) {
+        if (strcmp(name_str, "qore")) {
+            name_str += 5;
+        }
         printd(5, "QoreLoader::exec_module() found '%s' NS %p: '::%s'\n", name_str, ns, ns->getName());
+        // the module is visible to all programs in a shared interpreter
+        qore_python_pgm->pinQoreProgram();
         QoreProgramContextHelper pch(mod_pgm);
         qore_python_pgm->importQoreToPython(mod, *ns, name_str);
         std::string nspath = ns->getPath();
@@ -191,21 +224,47 @@ PyObject* QoreLoader::exec_module(PyObject* self, PyObject* args) {
     return Py_None;
 }
 
+const QoreNamespace* QoreLoader::getNamespaceForModule(const char* name, QoreProgram* mod_pgm) {
+    if (!strcmp(name, "qore")) {
+        return mod_pgm->getQoreNS();
+    }
+    assert(!strncmp(name, "qore.", 5));
+    name += 5;
+    if (strchr(name, '.')) {
+        return nullptr;
+    }
+    if (!strcmp(name, "__root__")) {
+        return mod_pgm->getRootNS();
+    }
+    return getModuleRootNs(name, mod_pgm);
+}
+
 const QoreNamespace* QoreLoader::getModuleRootNs(const char* name, QoreProgram* mod_pgm) {
-    ReferenceHolder<QoreHashNode> all_mod_info(MM.getModuleHash(), nullptr);
-    mod_dep_map_t mod_dep_map;
+    // module root namespaces are cached per program, as namespaces of loaded modules do not move
+    QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
+    bool use_cache = qore_python_pgm && qore_python_pgm->getQoreProgram() == mod_pgm;
+    if (use_cache) {
+        const QoreNamespace* rv = qore_python_pgm->getCachedModuleRootNs(name);
+        if (rv) {
+            return rv;
+        }
+    }
 
-    // otherwise look for a public namespace and then find the ealiest ancestor provided by the module
+    // otherwise look for a public namespace and then find the earliest ancestor provided by the module
     const QoreNamespace* root_ns = mod_pgm->getRootNS();
-    const QoreNamespace* rv = getModuleRootNsIntern(name, *root_ns, *all_mod_info, mod_dep_map, true);
-    if (!rv) {
-        rv = getModuleRootNsIntern(name, *root_ns, *all_mod_info, mod_dep_map, false);
+    const QoreNamespace* rv = getModuleRootNsIntern(name, *root_ns, true);
+    if (rv) {
+        if (use_cache) {
+            qore_python_pgm->cacheModuleRootNs(name, rv);
+        }
+        return rv;
     }
-    return rv;
+    // namespaces found only by name are not cached, as a module providing the namespace may be loaded later
+    return getModuleRootNsIntern(name, *root_ns, false);
 }
 
 const QoreNamespace* QoreLoader::getModuleRootNsIntern(const char* name, const QoreNamespace& root_ns,
-        const QoreHashNode* all_mod_info, mod_dep_map_t& mod_dep_map, bool check_mod) {
+        bool check_mod) {
     QoreNamespaceConstIterator i(root_ns);
     while (i.next()) {
         const QoreNamespace* ns = &i.get();
@@ -224,7 +283,7 @@ const QoreNamespace* QoreLoader::getModuleRootNsIntern(const char* name, const Q
         // try to find parent ns
         while (true) {
             const QoreNamespace* parent = ns->getParent();
-            if (!isModule(parent, name, all_mod_info, mod_dep_map)) {
+            if (!isModule(parent, name)) {
                 printd(5, "QoreLoader::getModuleRootNs('%s') invalid parent '%s'\n", name, parent->getPath().c_str());
                 break;
             }
@@ -237,8 +296,7 @@ const QoreNamespace* QoreLoader::getModuleRootNsIntern(const char* name, const Q
     return nullptr;
 }
 
-bool QoreLoader::isModule(const QoreNamespace* parent, const char* name, const QoreHashNode* all_mod_info,
-        mod_dep_map_t& mod_dep_map) {
+bool QoreLoader::isModule(const QoreNamespace* parent, const char* name) {
     const char* mod = parent->getModuleName();
     if (!mod) {
         return false;
@@ -247,37 +305,48 @@ bool QoreLoader::isModule(const QoreNamespace* parent, const char* name, const Q
         return true;
     }
 
-    if (!all_mod_info) {
+    if (!isReexported(name, mod)) {
+        //printd(5, "QoreLoader::isModule() NOT parent: '%s' mod: %s; not in reexport list\n", parent->getName(),
+        //  mod ? mod : "n/a");
         return false;
     }
+    return true;
+}
 
-    const QoreListNode* reexport_list = nullptr;
-
-    // see if we have the reexport list already
-    mod_dep_map_t::iterator i = mod_dep_map.lower_bound(mod);
-    if (i == mod_dep_map.end() || !strcmp(i->first, mod)) {
-        const QoreHashNode* mod_info = all_mod_info->getKeyValue(name).get<QoreHashNode>();
-        if (!mod_info) {
+bool QoreLoader::isReexported(const char* name, const char* mod) {
+    AutoLocker al(mod_reexport_lck);
+    mod_reexport_map_t::iterator i = mod_reexport_map.find(name);
+    if (i == mod_reexport_map.end()) {
+        // add modules loaded since the last update to the index
+        ReferenceHolder<QoreHashNode> all_mod_info(MM.getModuleHash(), nullptr);
+        if (!all_mod_info) {
             return false;
         }
-        reexport_list = mod_info->getKeyValue("reexported-modules").get<QoreListNode>();
-        if (!reexport_list) {
-            return false;
+        ConstHashIterator hi(*all_mod_info);
+        while (hi.next()) {
+            if (mod_reexport_map.find(hi.getKey()) != mod_reexport_map.end()) {
+                continue;
+            }
+            std::set<std::string>& reexport_set = mod_reexport_map[hi.getKey()];
+            const QoreHashNode* mod_info = hi.get().get<const QoreHashNode>();
+            const QoreListNode* reexport_list = mod_info
+                ? mod_info->getKeyValue("reexported-modules").get<const QoreListNode>()
+                : nullptr;
+            if (!reexport_list) {
+                continue;
+            }
+            ConstListIterator li(reexport_list);
+            while (li.next()) {
+                const QoreValue v = li.getValue();
+                if (v.getType() == NT_STRING) {
+                    reexport_set.insert(v.get<const QoreStringNode>()->c_str());
+                }
+            }
         }
-        mod_dep_map.insert(i, mod_dep_map_t::value_type(mod, reexport_list));
-    } else {
-        reexport_list = i->second;
-    }
-
-    ConstListIterator li(reexport_list);
-    while (li.next()) {
-        const QoreValue v = li.getValue();
-        if (v.getType() == NT_STRING && (*v.get<const QoreStringNode>() == mod)) {
-            return true;
+        i = mod_reexport_map.find(name);
+        if (i == mod_reexport_map.end()) {
+            return false;
         }
     }
-
-    //printd(5, "QoreLoader::isModule() NOT parent: '%s' mod: %s; not in reexport list\n", parent->getName(),
-    //  mod ? mod : "n/a");
-    return false;
+    return i->second.find(mod) != i->second.end();
 }
@@ -27,13 +27,12 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <string>
 
 // forward references
 class PythonQoreClass;
 
-// reexport list map
-typedef std::map<const char*, const QoreListNode*, ltstr> mod_dep_map_t;
-
 class QoreLoader {
 public:
     //! initializer function
@@ -59,14 +58,24 @@ private:
     DLLLOCAL static QorePythonManualReferenceHolder loader_cls;
     DLLLOCAL static QorePythonManualReferenceHolder loader;
 
+    //! returns the Qore namespace for the given Python module name or nullptr if not found
+    DLLLOCAL static const QoreNamespace* getNamespaceForModule(const char* name, QoreProgram* mod_pgm);
+
     DLLLOCAL static const QoreNamespace* getModuleRootNs(const char* name, QoreProgram* mod_pgm);
 
     DLLLOCAL static const QoreNamespace* getModuleRootNsIntern(const char* name, const QoreNamespace& root_ns,
-        const QoreHashNode* all_mod_info, mod_dep_map_t& mod_dep_map, bool check_mod);
+        bool check_mod);
 
     //! checks if "parent" is in the same module as "name" with a possible reexport list
-    DLLLOCAL static bool isModule(const QoreNamespace* parent, const char* name, const QoreHashNode* all_mod_info,
-        mod_dep_map_t& mod_dep_map);
+    DLLLOCAL static bool isModule(const QoreNamespace* parent, const char* name);
+
+    //! checks if module "name" reexports module "mod"
+    DLLLOCAL static bool isReexported(const char* name, const char* mod);
+
+    //! map of module names to the modules they reexport; loaded modules do not change, so entries are never removed
+    typedef std::map<std::string, std::set<std::string>> mod_reexport_map_t;
+    DLLLOCAL static mod_reexport_map_t mod_reexport_map;
+    DLLLOCAL static QoreThreadLock mod_reexport_lck;
 };
 
 #endif
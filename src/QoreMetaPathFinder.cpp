@@ -23,6 +23,7 @@
 #include "QoreLoader.h"
 #include "JavaLoader.h"
 #include "QorePythonProgram.h"
+#include "ModuleNamespace.h"
 
 QorePythonManualReferenceHolder QoreMetaPathFinder::qore_package;
 QorePythonManualReferenceHolder QoreMetaPathFinder::java_package;
@@ -35,6 +36,8 @@ Creates Python wrappers for Qore code.");
 
 static PyMethodDef QoreMetaPathFinder_methods[] = {
     {"find_spec", QoreMetaPathFinder::find_spec, METH_VARARGS, "QoreMetaPathFinder.find_spec() implementation"},
+    {"invalidate_caches", QoreMetaPathFinder::invalidate_caches, METH_NOARGS,
+        "QoreMetaPathFinder.invalidate_caches() implementation"},
     {nullptr, nullptr},
 };
 
@@ -186,11 +189,24 @@ PyObject* QoreMetaPathFinder::find_spec(PyObject* self, PyObject* args) {
     } else {
         QoreString mname(fname);
         if (mname.size() > 5 && mname.equalPartial("qore.")) {
+            QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
+            // check the lookup caches first
+            if (qore_python_pgm->isMissingModule(fname)) {
+                Py_INCREF(Py_None);
+                return Py_None;
+            }
+            PyObject* rv = qore_python_pgm->getCachedModuleSpec(fname);
+            if (rv) {
+                Py_INCREF(rv);
+                return rv;
+            }
+
             //mname.replace(0, 5, (const char*)nullptr);
-            PyObject* rv = tryLoadModule(mname, mname.c_str() + 5);
+            rv = tryLoadModule(mname, mname.c_str() + 5);
             if (rv) {
                 return rv;
             }
+            qore_python_pgm->setMissingModule(fname);
         } else if (mname.size() > 5 && mname.equalPartial("java.")) {
             //mname.replace(0, 5, (const char*)nullptr);
             PyObject* rv = getJavaNamespaceModule(mname, mname.c_str() + 5);
@@ -259,15 +275,14 @@ PyObject* QoreMetaPathFinder::getQoreRootModuleSpec(const QoreString& mname) {
     QorePythonReferenceHolder mod_spec(newModuleSpec(true, mname, QoreLoader::getLoaderRef()));
 
     QorePythonReferenceHolder search_locations(PyList_New(0));
-    // add namespaces as submodule search locations (NOTE: not functionally necessary it seems)
+    // add module root namespaces as submodule search locations (NOTE: not functionally necessary it seems); the
+    // module root namespace index is used instead of iterating all namespaces in the root namespace
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
-    const RootQoreNamespace* rns = qore_python_pgm->getQoreProgram()->getRootNS();
-    QoreNamespaceNamespaceIterator ni(*rns);
-    while (ni.next()) {
-        const QoreNamespace& ns = ni.get();
-        QoreStringMaker mod_name(ns.getName());
-        //printd(5, "QoreMetaPathFinder::getQoreRootModuleSpec(): adding '%s'\n", mod_name.c_str());
-        QorePythonReferenceHolder name(PyUnicode_FromStringAndSize(mod_name.c_str(), mod_name.size()));
+    QorePythonProgram::strset_t ns_names;
+    qore_python_pgm->getCachedModuleRootNsNames(ns_names);
+    for (const std::string& ns_name : ns_names) {
+        //printd(5, "QoreMetaPathFinder::getQoreRootModuleSpec(): adding '%s'\n", ns_name.c_str());
+        QorePythonReferenceHolder name(PyUnicode_FromStringAndSize(ns_name.c_str(), ns_name.size()));
         PyList_Append(*search_locations, *name);
     }
     PyObject_SetAttrString(*mod_spec, "submodule_search_locations", *search_locations);
@@ -281,6 +296,13 @@ PyObject* QoreMetaPathFinder::tryLoadModule(const QoreString& full_name, const c
         return getQoreRootModuleSpec(full_name);
     }
 
+    if (strchr(mod_name, '.')) {
+        PyObject* rv = getSubnamespaceModuleSpec(full_name);
+        if (rv) {
+            return rv;
+        }
+    }
+
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
     ExceptionSink xsink;
     if (ModuleManager::runTimeLoadModule(mod_name, qore_python_pgm->getQoreProgram(), &xsink)) {
@@ -295,7 +317,41 @@ PyObject* QoreMetaPathFinder::tryLoadModule(const QoreString& full_name, const c
         return nullptr;
     }
     assert(!xsink);
+    // a module was loaded; previous failed lookups may succeed now
+    QorePythonProgram::invalidateImportCaches();
+
+    PyObject* rv = newModuleSpec(true, full_name, QoreLoader::getLoaderRef());
+    qore_python_pgm->cacheModuleSpec(full_name.c_str(), rv);
+    return rv;
+}
 
+PyObject* QoreMetaPathFinder::invalidate_caches(PyObject* self, PyObject* args) {
+    QorePythonProgram::invalidateImportCaches();
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject* QoreMetaPathFinder::getSubnamespaceModuleSpec(const QoreString& full_name) {
+    const char* p = strrchr(full_name.c_str(), '.');
+    assert(p);
+    std::string parent_name(full_name.c_str(), p - full_name.c_str());
+
+    // returns a borrowed reference
+    PyObject* parent = PyDict_GetItemString(PyImport_GetModuleDict(), parent_name.c_str());
+    if (!parent || !ModuleNamespace_Check(parent)) {
+        return nullptr;
+    }
+
+    // creates the submodule on demand and saves it in sys.modules, where QoreLoader::create_module() will find it
+    QorePythonReferenceHolder sub(PyObject_GetAttrString(parent, p + 1));
+    if (!sub) {
+        PyErr_Clear();
+        return nullptr;
+    }
+    if (!ModuleNamespace_Check(*sub)) {
+        return nullptr;
+    }
+    printd(5, "QoreMetaPathFinder::getSubnamespaceModuleSpec() found '%s'\n", full_name.c_str());
     return newModuleSpec(true, full_name, QoreLoader::getLoaderRef());
 }
 
@@ -44,6 +44,7 @@ public:
 
     //! class methods
     DLLLOCAL static PyObject* find_spec(PyObject* self, PyObject* args);
+    DLLLOCAL static PyObject* invalidate_caches(PyObject* self, PyObject* args);
 
     //! Retuns a new module spec object
     /** @param qore qore or java loader
@@ -61,6 +62,8 @@ private:
     DLLLOCAL static PyObject* getJavaPackageModuleSpec();
     DLLLOCAL static PyObject* getQoreRootModuleSpec(const QoreString& mname);
     DLLLOCAL static PyObject* tryLoadModule(const QoreString& full_name, const char* mod_name);
+    //! returns a module spec if the module is a subnamespace of an imported namespace module, otherwise nullptr
+    DLLLOCAL static PyObject* getSubnamespaceModuleSpec(const QoreString& full_name);
     DLLLOCAL static PyObject* getJavaNamespaceModule(const QoreString& full_name, const char* mod_name);
 };
 
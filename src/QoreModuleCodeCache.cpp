@@ -0,0 +1,456 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QoreModuleCodeCache.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QoreModuleCodeCache.h"
+
+#include <marshal.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+std::atomic<bool> QoreModuleCodeCache::enabled(false);
+std::atomic<uint64_t> QoreModuleCodeCache::hits(0);
+std::atomic<uint64_t> QoreModuleCodeCache::misses(0);
+
+namespace {
+//! finder object; one per interpreter
+struct module_code_finder {
+    PyObject_HEAD
+    //! importlib.machinery.PathFinder.find_spec in the finder's interpreter
+    PyObject* find_spec;
+    //! importlib.machinery.SourceFileLoader in the finder's interpreter
+    PyObject* source_loader_cls;
+};
+
+//! loader object wrapping a SourceFileLoader
+struct module_code_loader {
+    PyObject_HEAD
+    //! the wrapped loader
+    PyObject* loader;
+};
+
+//! cached marshaled code for a source file
+struct module_code_entry {
+    time_t mtime;
+    off_t size;
+    ino_t ino;
+    std::shared_ptr<const std::string> code;
+};
+
+typedef std::map<std::string, module_code_entry> module_code_map_t;
+
+//! process-wide code cache
+struct module_code_cache {
+    module_code_map_t map;
+    //! total size of marshaled code in bytes
+    size_t size = 0;
+    QoreThreadLock lck;
+};
+}
+
+static module_code_cache& get_cache() {
+    // never destroyed to allow for use at exit
+    static module_code_cache* cache = new module_code_cache;
+    return *cache;
+}
+
+PyDoc_STRVAR(QoreModuleCodeCacheFinder_doc,
+"QoreModuleCodeCacheFinder()\n\
+\n\
+Finds pure Python modules and loads their code from a process-wide cache.");
+
+static PyMethodDef QoreModuleCodeCacheFinder_methods[] = {
+    {"find_spec", QoreModuleCodeCache::find_spec, METH_VARARGS,
+        "QoreModuleCodeCacheFinder.find_spec() implementation"},
+    {nullptr, nullptr},
+};
+
+PyTypeObject QoreModuleCodeCacheFinder_Type = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "QoreModuleCodeCacheFinder",  // tp_name
+    sizeof(module_code_finder),   // tp_basicsize
+    0,                            // tp_itemsize
+    // Slots
+    (destructor)QoreModuleCodeCache::finder_dealloc,  // tp_dealloc
+    0,                            // tp_vectorcall_offset
+    0,                            // tp_getattr
+    0,                            // tp_setattr
+    0,                            // tp_as_async
+    0,                            // tp_repr
+    0,                            // tp_as_number
+    0,                            // tp_as_sequence
+    0,                            // tp_as_mapping
+    0,                            // tp_hash
+    0,                            // tp_call
+    0,                            // tp_str
+    PyObject_GenericGetAttr,      // tp_getattro
+    0,                            // tp_setattro
+    0,                            // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,           // tp_flags
+    QoreModuleCodeCacheFinder_doc,  // tp_doc
+    0,                            // tp_traverse
+    0,                            // tp_clear
+    0,                            // tp_richcompare
+    0,                            // tp_weaklistoffset
+    0,                            // tp_iter
+    0,                            // tp_iternext
+    QoreModuleCodeCacheFinder_methods,  // tp_methods
+    0,                            // tp_members
+    0,                            // tp_getset
+    &PyBaseObject_Type,           // tp_base
+    0,                            // tp_dict
+    0,                            // tp_descr_get
+    0,                            // tp_descr_set
+    0,                            // tp_dictoffset
+    0,                            // tp_init
+    PyType_GenericAlloc,          // tp_alloc
+    0,                            // tp_new
+    PyObject_Del,                 // tp_free
+};
+
+PyDoc_STRVAR(QoreModuleCodeCacheLoader_doc,
+"QoreModuleCodeCacheLoader()\n\
+\n\
+Loads pure Python module code from a process-wide cache; other attributes are provided by the wrapped loader.");
+
+static PyMethodDef QoreModuleCodeCacheLoader_methods[] = {
+    {"create_module", QoreModuleCodeCache::create_module, METH_VARARGS,
+        "QoreModuleCodeCacheLoader.create_module() implementation"},
+    {"exec_module", QoreModuleCodeCache::exec_module, METH_VARARGS,
+        "QoreModuleCodeCacheLoader.exec_module() implementation"},
+    {"get_code", QoreModuleCodeCache::get_code, METH_VARARGS,
+        "QoreModuleCodeCacheLoader.get_code() implementation"},
+    {nullptr, nullptr},
+};
+
+PyTypeObject QoreModuleCodeCacheLoader_Type = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    "QoreModuleCodeCacheLoader",  // tp_name
+    sizeof(module_code_loader),   // tp_basicsize
+    0,                            // tp_itemsize
+    // Slots
+    (destructor)QoreModuleCodeCache::loader_dealloc,  // tp_dealloc
+    0,                            // tp_vectorcall_offset
+    0,                            // tp_getattr
+    0,                            // tp_setattr
+    0,                            // tp_as_async
+    0,                            // tp_repr
+    0,                            // tp_as_number
+    0,                            // tp_as_sequence
+    0,                            // tp_as_mapping
+    0,                            // tp_hash
+    0,                            // tp_call
+    0,                            // tp_str
+    QoreModuleCodeCache::loader_getattro,  // tp_getattro
+    0,                            // tp_setattro
+    0,                            // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,           // tp_flags
+    QoreModuleCodeCacheLoader_doc,  // tp_doc
+    0,                            // tp_traverse
+    0,                            // tp_clear
+    0,                            // tp_richcompare
+    0,                            // tp_weaklistoffset
+    0,                            // tp_iter
+    0,                            // tp_iternext
+    QoreModuleCodeCacheLoader_methods,  // tp_methods
+    0,                            // tp_members
+    0,                            // tp_getset
+    &PyBaseObject_Type,           // tp_base
+    0,                            // tp_dict
+    0,                            // tp_descr_get
+    0,                            // tp_descr_set
+    0,                            // tp_dictoffset
+    0,                            // tp_init
+    PyType_GenericAlloc,          // tp_alloc
+    0,                            // tp_new
+    PyObject_Del,                 // tp_free
+};
+
+int QoreModuleCodeCache::init() {
+    if (PyType_Ready(&QoreModuleCodeCacheFinder_Type) < 0 || PyType_Ready(&QoreModuleCodeCacheLoader_Type) < 0) {
+        printd(5, "QoreModuleCodeCache::init() type initialization failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+int QoreModuleCodeCache::setupModules() {
+    // importlib classes are specific to each interpreter
+    QorePythonReferenceHolder mod(PyImport_ImportModule("importlib.machinery"));
+    if (!mod) {
+        printd(5, "QoreModuleCodeCache::setupModules() ERROR: no importlib.machinery module\n");
+        PyErr_Clear();
+        return -1;
+    }
+    QorePythonReferenceHolder path_finder(PyObject_GetAttrString(*mod, "PathFinder"));
+    QorePythonReferenceHolder find_spec(path_finder ? PyObject_GetAttrString(*path_finder, "find_spec") : nullptr);
+    QorePythonReferenceHolder source_loader_cls(PyObject_GetAttrString(*mod, "SourceFileLoader"));
+    if (!find_spec || !source_loader_cls) {
+        printd(5, "QoreModuleCodeCache::setupModules() ERROR: missing importlib.machinery classes\n");
+        PyErr_Clear();
+        return -1;
+    }
+
+    QorePythonReferenceHolder finder(PyType_GenericAlloc(&QoreModuleCodeCacheFinder_Type, 0));
+    if (!finder) {
+        PyErr_Clear();
+        return -1;
+    }
+    module_code_finder* f = reinterpret_cast<module_code_finder*>(*finder);
+    f->find_spec = find_spec.release();
+    f->source_loader_cls = source_loader_cls.release();
+
+    QorePythonReferenceHolder sys(PyImport_ImportModule("sys"));
+    QorePythonReferenceHolder meta_path(sys ? PyObject_GetAttrString(*sys, "meta_path") : nullptr);
+    if (!meta_path || !PyList_Check(*meta_path)) {
+        printd(5, "QoreModuleCodeCache::setupModules() ERROR: no sys.meta_path list\n");
+        PyErr_Clear();
+        return -1;
+    }
+
+    // must be directly before the standard path finder, so that builtin and frozen modules are still found by their
+    // finders first; if the path finder is not present, the finder is added at the end
+    Py_ssize_t len = PyList_GET_SIZE(*meta_path);
+    Py_ssize_t pos = 0;
+    while (pos < len && PyList_GET_ITEM(*meta_path, pos) != *path_finder) {
+        ++pos;
+    }
+    if (PyList_Insert(*meta_path, pos, *finder)) {
+        printd(5, "QoreModuleCodeCache::setupModules() ERROR: failed to insert finder in sys.meta_path\n");
+        PyErr_Clear();
+        return -1;
+    }
+    return 0;
+}
+
+void QoreModuleCodeCache::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+    if (!enable) {
+        module_code_cache& cache = get_cache();
+        AutoLocker al(cache.lck);
+        cache.map.clear();
+        cache.size = 0;
+    }
+}
+
+void QoreModuleCodeCache::initFromEnvironment() {
+    const char* val = getenv("QORE_PYTHON_MODULE_CODE_CACHE");
+    if (val && *val && strcmp(val, "0")) {
+        setEnabled(true);
+    }
+}
+
+QoreHashNode* QoreModuleCodeCache::getInfo() {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("enabled", isEnabled(), nullptr);
+    {
+        module_code_cache& cache = get_cache();
+        AutoLocker al(cache.lck);
+        rv->setKeyValue("entries", (int64)cache.map.size(), nullptr);
+        rv->setKeyValue("size", (int64)cache.size, nullptr);
+    }
+    rv->setKeyValue("hits", (int64)hits.load(std::memory_order_relaxed), nullptr);
+    rv->setKeyValue("misses", (int64)misses.load(std::memory_order_relaxed), nullptr);
+    return rv.release();
+}
+
+void QoreModuleCodeCache::finder_dealloc(PyObject* self) {
+    module_code_finder* f = reinterpret_cast<module_code_finder*>(self);
+    Py_XDECREF(f->find_spec);
+    Py_XDECREF(f->source_loader_cls);
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyObject* QoreModuleCodeCache::find_spec(PyObject* self, PyObject* args) {
+    // returns a borrowed reference
+    PyObject* fullname = PyTuple_GetItem(args, 0);
+    if (!isEnabled() || !fullname || !PyUnicode_Check(fullname)) {
+        PyErr_Clear();
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    // Qore and Java modules are handled by QoreMetaPathFinder
+    const char* fname = PyUnicode_AsUTF8(fullname);
+    if (!strcmp(fname, "qore") || !strcmp(fname, "java") || !strncmp(fname, "qore.", 5)
+        || !strncmp(fname, "java.", 5)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    // the spec is returned for all modules found, so the path finder does not need to search again
+    module_code_finder* f = reinterpret_cast<module_code_finder*>(self);
+    QorePythonReferenceHolder spec(PyObject_Call(f->find_spec, args, nullptr));
+    if (!spec || *spec == Py_None) {
+        return spec.release();
+    }
+
+    QorePythonReferenceHolder loader(PyObject_GetAttrString(*spec, "loader"));
+    if (!loader) {
+        PyErr_Clear();
+        return spec.release();
+    }
+    // only source files are cached
+    if ((PyObject*)Py_TYPE(*loader) != f->source_loader_cls) {
+        return spec.release();
+    }
+
+    QorePythonReferenceHolder wrapper(PyType_GenericAlloc(&QoreModuleCodeCacheLoader_Type, 0));
+    if (!wrapper) {
+        PyErr_Clear();
+        return spec.release();
+    }
+    reinterpret_cast<module_code_loader*>(*wrapper)->loader = loader.release();
+    if (PyObject_SetAttrString(*spec, "loader", *wrapper)) {
+        PyErr_Clear();
+    }
+    return spec.release();
+}
+
+void QoreModuleCodeCache::loader_dealloc(PyObject* self) {
+    Py_XDECREF(reinterpret_cast<module_code_loader*>(self)->loader);
+    Py_TYPE(self)->tp_free(self);
+}
+
+PyObject* QoreModuleCodeCache::loader_getattro(PyObject* self, PyObject* attr) {
+    PyObject* rv = PyObject_GenericGetAttr(self, attr);
+    if (rv || !PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        return rv;
+    }
+    // all other attributes are provided by the wrapped loader
+    PyErr_Clear();
+    return PyObject_GetAttr(reinterpret_cast<module_code_loader*>(self)->loader, attr);
+}
+
+PyObject* QoreModuleCodeCache::create_module(PyObject* self, PyObject* args) {
+    // use default module creation
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject* QoreModuleCodeCache::exec_module(PyObject* self, PyObject* args) {
+    // returns a borrowed reference
+    PyObject* module = PyTuple_GetItem(args, 0);
+    if (!module) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder name(PyObject_GetAttrString(module, "__name__"));
+    if (!name) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder code(getCode(self, *name));
+    if (!code) {
+        return nullptr;
+    }
+    if (*code == Py_None) {
+        PyErr_Format(PyExc_ImportError, "cannot load module '%S' when get_code() returns None", *name);
+        return nullptr;
+    }
+    QorePythonReferenceHolder dict(PyObject_GetAttrString(module, "__dict__"));
+    if (!dict) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder rv(PyEval_EvalCode(*code, *dict, *dict));
+    if (!rv) {
+        return nullptr;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject* QoreModuleCodeCache::get_code(PyObject* self, PyObject* args) {
+    // returns a borrowed reference
+    PyObject* fullname = PyTuple_GetItem(args, 0);
+    if (!fullname) {
+        return nullptr;
+    }
+    return getCode(self, fullname);
+}
+
+PyObject* QoreModuleCodeCache::getCode(PyObject* self, PyObject* fullname) {
+    PyObject* loader = reinterpret_cast<module_code_loader*>(self)->loader;
+
+    QorePythonReferenceHolder path(PyObject_GetAttrString(loader, "path"));
+    struct stat sbuf;
+    bool have_stat = path && PyUnicode_Check(*path) && !stat(PyUnicode_AsUTF8(*path), &sbuf);
+    PyErr_Clear();
+
+    module_code_cache& cache = get_cache();
+    if (have_stat) {
+        std::shared_ptr<const std::string> data;
+        {
+            AutoLocker al(cache.lck);
+            module_code_map_t::iterator i = cache.map.find(PyUnicode_AsUTF8(*path));
+            if (i != cache.map.end() && i->second.mtime == sbuf.st_mtime && i->second.size == sbuf.st_size
+                && i->second.ino == sbuf.st_ino) {
+                data = i->second.code;
+            }
+        }
+        if (data) {
+            PyObject* code = PyMarshal_ReadObjectFromString(data->data(), data->size());
+            if (code && PyCode_Check(code)) {
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return code;
+            }
+            Py_XDECREF(code);
+            PyErr_Clear();
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    QorePythonReferenceHolder code(PyObject_CallMethod(loader, "get_code", "O", fullname));
+    if (!code || !have_stat || !PyCode_Check(*code) || !isEnabled()) {
+        return code.release();
+    }
+
+    QorePythonReferenceHolder data(PyMarshal_WriteObjectToString(*code, Py_MARSHAL_VERSION));
+    if (!data || !PyBytes_Check(*data)) {
+        PyErr_Clear();
+        return code.release();
+    }
+    std::shared_ptr<const std::string> str = std::make_shared<const std::string>(PyBytes_AS_STRING(*data),
+        (size_t)PyBytes_GET_SIZE(*data));
+    {
+        AutoLocker al(cache.lck);
+        module_code_entry& entry = cache.map[PyUnicode_AsUTF8(*path)];
+        if (entry.code) {
+            cache.size -= entry.code->size();
+        }
+        entry = {sbuf.st_mtime, sbuf.st_size, sbuf.st_ino, str};
+        cache.size += str->size();
+    }
+    return code.release();
+}
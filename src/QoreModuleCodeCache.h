@@ -0,0 +1,88 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QoreModuleCodeCache.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_PYTHON_QOREMODULECODECACHE_H
+
+#define _QORE_PYTHON_QOREMODULECODECACHE_H
+
+#include "python-module.h"
+
+#include <atomic>
+
+//! optional process-wide in-memory cache of marshaled code for pure Python modules
+/** a finder inserted at the start of \c sys.meta_path in each interpreter wraps the loaders of source modules found
+    by \c importlib.machinery.PathFinder; the wrapping loader stores marshaled code objects in a process-wide cache,
+    so later interpreters importing the same modules unmarshal code from memory instead of reading and validating
+    \c .pyc files; entries are invalidated when the source file's modification time, size, or inode changes
+*/
+class QoreModuleCodeCache {
+public:
+    //! initializer function
+    DLLLOCAL static int init();
+
+    //! inserts the finder in sys.meta_path in the current interpreter
+    DLLLOCAL static int setupModules();
+
+    //! enables or disables the cache; the cache is cleared when disabled
+    DLLLOCAL static void setEnabled(bool enable);
+
+    //! returns true if the cache is enabled
+    DLLLOCAL static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    //! sets the cache configuration from the environment, if present
+    DLLLOCAL static void initFromEnvironment();
+
+    //! returns a hash describing the cache state and statistics
+    DLLLOCAL static QoreHashNode* getInfo();
+
+    //! finder type functions
+    DLLLOCAL static void finder_dealloc(PyObject* self);
+    DLLLOCAL static PyObject* find_spec(PyObject* self, PyObject* args);
+
+    //! loader type functions
+    DLLLOCAL static void loader_dealloc(PyObject* self);
+    DLLLOCAL static PyObject* loader_getattro(PyObject* self, PyObject* attr);
+    DLLLOCAL static PyObject* create_module(PyObject* self, PyObject* args);
+    DLLLOCAL static PyObject* exec_module(PyObject* self, PyObject* args);
+    DLLLOCAL static PyObject* get_code(PyObject* self, PyObject* args);
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+    DLLLOCAL static std::atomic<uint64_t> hits;
+    DLLLOCAL static std::atomic<uint64_t> misses;
+
+    //! returns a new reference to the code object for the given module; the GIL must be held
+    DLLLOCAL static PyObject* getCode(PyObject* self, PyObject* fullname);
+};
+
+#endif
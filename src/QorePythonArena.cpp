@@ -0,0 +1,141 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonArena.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#include "QorePythonArena.h"
+
+#include <cstdlib>
+#include <cstring>
+
+constexpr size_t QorePythonArena::BLOCK_SIZE;
+
+//! alignment for all arena allocations
+static constexpr size_t ARENA_ALIGN = alignof(std::max_align_t);
+
+//! rounds the given size up to the arena alignment
+static inline size_t arena_align(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+//! FNV-1a hash
+static inline size_t arena_hash(const char* str, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)str[i];
+        h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+}
+
+void* QorePythonArena::allocate(size_t bytes) {
+    bytes = arena_align(bytes ? bytes : 1);
+    if ((size_t)(end - pos) < bytes) {
+        return allocateBlock(bytes);
+    }
+    void* rv = pos;
+    pos += bytes;
+    return rv;
+}
+
+void* QorePythonArena::allocateBlock(size_t bytes) {
+    size_t hdr = arena_align(sizeof(block_t));
+    // large allocations get their own block so the free space in the current block is not lost
+    bool dedicated = bytes > BLOCK_SIZE / 4;
+    size_t bsize = hdr + (dedicated ? bytes : BLOCK_SIZE);
+    block_t* b = reinterpret_cast<block_t*>(malloc(bsize));
+    if (!b) {
+        throw std::bad_alloc();
+    }
+    size += bsize;
+    char* data = reinterpret_cast<char*>(b) + hdr;
+    if (dedicated && head) {
+        b->next = head->next;
+        head->next = b;
+        return data;
+    }
+    b->next = head;
+    head = b;
+    pos = data + bytes;
+    end = data + (dedicated ? bytes : BLOCK_SIZE);
+    return data;
+}
+
+const char* QorePythonArena::saveString(const char* str, size_t len) {
+    // keep the load factor at or below 1/2
+    if ((str_count + 1) * 2 > str_table.size()) {
+        growStringTable();
+    }
+
+    size_t hash = arena_hash(str, len);
+    size_t mask = str_table.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        str_entry_t& e = str_table[i];
+        if (!e.str) {
+            char* p = reinterpret_cast<char*>(allocate(len + 1));
+            memcpy(p, str, len);
+            p[len] = '\0';
+            e = {p, len, hash};
+            ++str_count;
+            return p;
+        }
+        if (e.hash == hash && e.len == len && !memcmp(e.str, str, len)) {
+            return e.str;
+        }
+    }
+}
+
+void QorePythonArena::growStringTable() {
+    str_table_t old_table(str_table.empty() ? 64 : str_table.size() * 2, str_entry_t {nullptr, 0, 0});
+    old_table.swap(str_table);
+    size_t mask = str_table.size() - 1;
+    for (auto& e : old_table) {
+        if (!e.str) {
+            continue;
+        }
+        size_t i = e.hash & mask;
+        while (str_table[i].str) {
+            i = (i + 1) & mask;
+        }
+        str_table[i] = e;
+    }
+}
+
+void QorePythonArena::clear() {
+    while (head) {
+        block_t* next = head->next;
+        free(head);
+        head = next;
+    }
+    pos = end = nullptr;
+    size = 0;
+    str_table_t().swap(str_table);
+    str_count = 0;
+}
@@ -0,0 +1,130 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonArena.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#ifndef _QORE_QOREPYTHONARENA_H
+
+#define _QORE_QOREPYTHONARENA_H
+
+#include <qore/Qore.h>
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//! bump allocator for bridge metadata that lives as long as the program that created it
+/** memory is allocated sequentially from large blocks and only freed when the arena is destroyed; strings saved in
+    the arena are interned with an open-addressing hash table
+*/
+class QorePythonArena {
+public:
+    DLLLOCAL QorePythonArena() {
+    }
+
+    DLLLOCAL ~QorePythonArena() {
+        clear();
+    }
+
+    QorePythonArena(const QorePythonArena&) = delete;
+    QorePythonArena& operator=(const QorePythonArena&) = delete;
+
+    //! returns memory aligned for any fundamental type; the memory is freed with the arena
+    DLLLOCAL void* allocate(size_t size);
+
+    //! creates a value-initialized object in the arena; the object's destructor is never called
+    template <typename T>
+    DLLLOCAL T* create() {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects must be trivially destructible");
+        return new (allocate(sizeof(T))) T();
+    }
+
+    //! returns a unique copy of the given string
+    DLLLOCAL const char* saveString(const char* str, size_t len);
+
+    //! returns a unique copy of the given string
+    DLLLOCAL const char* saveString(const char* str) {
+        return saveString(str, strlen(str));
+    }
+
+    //! frees all memory in the arena
+    DLLLOCAL void clear();
+
+    //! returns the number of bytes allocated from the system
+    DLLLOCAL size_t getSize() const {
+        return size;
+    }
+
+    //! returns the number of unique strings saved
+    DLLLOCAL size_t getStringCount() const {
+        return str_count;
+    }
+
+private:
+    //! the default block size
+    static constexpr size_t BLOCK_SIZE = 16384;
+
+    //! block header; the data follows the header
+    struct block_t {
+        block_t* next;
+    };
+
+    //! string table entry; an empty entry has str == nullptr
+    struct str_entry_t {
+        const char* str;
+        size_t len;
+        size_t hash;
+    };
+    typedef std::vector<str_entry_t> str_table_t;
+
+    //! list of allocated blocks; the first block is the current block
+    block_t* head = nullptr;
+    //! the next free byte in the current block
+    char* pos = nullptr;
+    //! the end of the current block
+    char* end = nullptr;
+    //! bytes allocated from the system
+    size_t size = 0;
+
+    //! interned strings; the size is always zero or a power of two
+    str_table_t str_table;
+    //! the number of strings in the table
+    size_t str_count = 0;
+
+    //! allocates a new block with room for at least the given number of bytes
+    DLLLOCAL void* allocateBlock(size_t bytes);
+
+    //! doubles the size of the string table
+    DLLLOCAL void growStringTable();
+};
+
+#endif
@@ -120,6 +120,15 @@ QoreValue QorePythonClass::memberGate(const QoreMethod& meth, void* m, QoreObjec
     return cls->getPythonMember(pypgm, mname->c_str(), pd, xsink);
 }
 
+PyObject* QorePythonClass::lookupType(PyTypeObject* type, const char* name) {
+    QorePythonReferenceHolder name_obj(PyUnicode_FromString(name));
+    if (!name_obj) {
+        PyErr_Clear();
+        return nullptr;
+    }
+    return _PyType_Lookup(type, *name_obj);
+}
+
 QoreValue QorePythonClass::callPythonMethod(ExceptionSink* xsink, QorePythonProgram* pypgm, const char* mname,
         const QoreListNode* args, QorePythonPrivateData* pd, size_t arg_offset) const {
     PyObject* pyobj = pd->get();
@@ -128,8 +137,12 @@ QoreValue QorePythonClass::callPythonMethod(ExceptionSink* xsink, QorePythonProg
     if (pypgm->checkValid(xsink)) {
         return QoreValue();
     }
-    // returns a borrowed reference
-    PyObject* attr = PyDict_GetItemString(mtype->tp_dict, mname);
+    // returns a borrowed reference; searches the type's MRO
+    PyObject* attr = lookupType(mtype, mname);
+    // "copy" is exported as "_copy" to avoid a conflict with the Qore copy method
+    if (!attr && !strcmp(mname, "_copy")) {
+        attr = lookupType(mtype, "copy");
+    }
     if (!attr) {
         xsink->raiseException("METHOD-DOES-NOT-EXIST", "Python value of type '%s' has no method or member '%s'",
             mtype->tp_name, mname);
@@ -82,6 +82,16 @@ public:
         return pypgm;
     }
 
+    //! returns true if all methods and members have been added to the class
+    DLLLOCAL bool isFull() const {
+        return full;
+    }
+
+    //! marks the class as having all methods and members
+    DLLLOCAL void setFull() {
+        full = true;
+    }
+
     DLLLOCAL PyObject* getPyObject(QoreObject* self, ExceptionSink* xsink) const;
 
     DLLLOCAL int setPyObject(QoreObject* self, PyObject* pyself, ExceptionSink* xsink) const;
@@ -92,6 +102,9 @@ public:
     DLLLOCAL QoreValue callPythonMethod(ExceptionSink* xsink, QorePythonProgram* pypgm, const char* mname, const QoreListNode* args,
         QorePythonPrivateData* pd, size_t arg_offset = 0) const;
 
+    //! Looks up an attribute in the given type and its bases; returns a borrowed reference or nullptr
+    DLLLOCAL static PyObject* lookupType(PyTypeObject* type, const char* name);
+
     DLLLOCAL static QoreValue memberGate(const QoreMethod& meth, void* m, QoreObject* self, QorePythonPrivateData* pd,
         const QoreListNode* args, q_rt_flags_t rtflags, ExceptionSink* xsink);
 
@@ -105,6 +118,8 @@ private:
     typedef std::map<std::string, PyMemberDef*> mem_map_t;
     mem_map_t mem_map;
     std::string pname;
+    //! true if all methods and members were added when the class was created or upgraded afterwards
+    bool full = false;
 
     static type_vec_t gateParamTypeInfo;
 
@@ -0,0 +1,353 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonCodeCache.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QorePythonCodeCache.h"
+
+#include <marshal.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define QORE_PYTHON_CODE_CACHE_EXT ".qpyc"
+
+std::atomic<bool> QorePythonCodeCache::enabled(false);
+std::atomic<uint64_t> QorePythonCodeCache::hits(0);
+std::atomic<uint64_t> QorePythonCodeCache::misses(0);
+std::atomic<uint64_t> QorePythonCodeCache::writes(0);
+
+namespace {
+//! code cache configuration
+struct code_cache_config {
+    std::string dir;
+    int64 max_size = 0;
+    QoreThreadLock lck;
+};
+
+//! cache file information for eviction
+struct code_cache_file {
+    std::string path;
+    time_t mtime;
+    off_t size;
+};
+}
+
+static code_cache_config& get_config() {
+    // never destroyed to allow for use at exit
+    static code_cache_config* config = new code_cache_config;
+    return *config;
+}
+
+// FNV-1a 64-bit hash
+static uint64_t fnv_hash(uint64_t h, const char* p, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// sdbm hash, used to detect file name hash collisions
+static uint64_t sdbm_hash(const char* p, size_t len) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < len; ++i) {
+        h = (unsigned char)p[i] + (h << 6) + (h << 16) - h;
+    }
+    return h;
+}
+
+template <typename T>
+static void append_raw(std::string& str, T val) {
+    str.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+// returns the optimization level of the current interpreter as given by sys.flags.optimize; the GIL must be held
+static int get_optimize_level() {
+    // returns a borrowed reference
+    PyObject* flags = PySys_GetObject("flags");
+    if (!flags) {
+        return 0;
+    }
+    QorePythonReferenceHolder optimize(PyObject_GetAttrString(flags, "optimize"));
+    if (!optimize || !PyLong_Check(*optimize)) {
+        PyErr_Clear();
+        return 0;
+    }
+    return (int)PyLong_AsLong(*optimize);
+}
+
+// returns true if the file is owned by the current user and is not writable by the group or others
+static bool is_trusted(const struct stat& sbuf) {
+    return sbuf.st_uid == geteuid() && !(sbuf.st_mode & (S_IWGRP | S_IWOTH));
+}
+
+// returns the header identifying the source in a cache file
+static std::string get_header(const char* src, size_t len, const char* label, int start, int optimize) {
+    std::string header("QPYC2");
+    append_raw(header, (int64_t)PyImport_GetMagicNumber());
+    append_raw(header, (int32_t)start);
+    append_raw(header, (int32_t)optimize);
+    append_raw(header, (uint64_t)len);
+    append_raw(header, sdbm_hash(src, len));
+    header.append(label);
+    header.push_back('\0');
+    return header;
+}
+
+int QorePythonCodeCache::setDirectory(ExceptionSink* xsink, const char* dir, int64 max_size) {
+    if (max_size < 0) {
+        xsink->raiseException("PYTHON-CODE-CACHE-ERROR", "invalid maximum size " QLLD "; expecting a value >= 0",
+            max_size);
+        return -1;
+    }
+
+    code_cache_config& config = get_config();
+    AutoLocker al(config.lck);
+    if (!dir || !*dir) {
+        config.dir.clear();
+        config.max_size = 0;
+        enabled.store(false, std::memory_order_relaxed);
+        return 0;
+    }
+
+    if (mkdir(dir, 0700) && errno != EEXIST) {
+        xsink->raiseErrnoException("PYTHON-CODE-CACHE-ERROR", errno, "cannot create cache directory '%s'", dir);
+        return -1;
+    }
+    struct stat sbuf;
+    if (stat(dir, &sbuf) || !S_ISDIR(sbuf.st_mode)) {
+        xsink->raiseException("PYTHON-CODE-CACHE-ERROR", "'%s' is not a directory", dir);
+        return -1;
+    }
+    // cached code is executed, so the cache must not be writable by other users
+    if (!is_trusted(sbuf)) {
+        xsink->raiseException("PYTHON-CODE-CACHE-ERROR", "cache directory '%s' must be owned by the current user "
+            "and must not be writable by the group or others", dir);
+        return -1;
+    }
+
+    config.dir = dir;
+    config.max_size = max_size;
+    enabled.store(true, std::memory_order_relaxed);
+    return 0;
+}
+
+void QorePythonCodeCache::initFromEnvironment() {
+    const char* dir = getenv("QORE_PYTHON_CODE_CACHE_DIR");
+    if (!dir || !*dir) {
+        return;
+    }
+    const char* max_size = getenv("QORE_PYTHON_CODE_CACHE_MAX_SIZE");
+    ExceptionSink xsink;
+    if (setDirectory(&xsink, dir, max_size ? strtoll(max_size, nullptr, 10) : 0)) {
+        // the cache is optional; ignore errors
+        xsink.clear();
+    }
+}
+
+QoreHashNode* QorePythonCodeCache::getInfo() {
+    std::string dir;
+    int64 max_size;
+    bool en = getConfig(dir, max_size);
+
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("enabled", en, nullptr);
+    if (en) {
+        rv->setKeyValue("dir", new QoreStringNode(dir), nullptr);
+    }
+    rv->setKeyValue("max_size", max_size, nullptr);
+    rv->setKeyValue("hits", (int64)hits.load(std::memory_order_relaxed), nullptr);
+    rv->setKeyValue("misses", (int64)misses.load(std::memory_order_relaxed), nullptr);
+    rv->setKeyValue("writes", (int64)writes.load(std::memory_order_relaxed), nullptr);
+    return rv.release();
+}
+
+bool QorePythonCodeCache::getConfig(std::string& dir, int64& max_size) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+        max_size = 0;
+        return false;
+    }
+    code_cache_config& config = get_config();
+    AutoLocker al(config.lck);
+    dir = config.dir;
+    max_size = config.max_size;
+    return !dir.empty();
+}
+
+PyObject* QorePythonCodeCache::compile(const char* src, const char* label, int start) {
+    std::string dir;
+    int64 max_size;
+    if (!getConfig(dir, max_size)) {
+        return Py_CompileString(src, label, start);
+    }
+
+    // the optimization level is part of the key, and code is compiled explicitly with the same level
+    int optimize = get_optimize_level();
+    size_t len = strlen(src);
+    std::string header = get_header(src, len, label, start, optimize);
+    uint64_t key = fnv_hash(fnv_hash(0xcbf29ce484222325ULL, header.data(), header.size()), src, len);
+    char name[32];
+    snprintf(name, sizeof name, "%016llx" QORE_PYTHON_CODE_CACHE_EXT, (unsigned long long)key);
+    std::string path = dir + "/" + name;
+
+    PyObject* code = read(path, header);
+    if (code) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return code;
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    code = Py_CompileStringExFlags(src, label, start, nullptr, optimize);
+    if (code && !write(path, header, code)) {
+        writes.fetch_add(1, std::memory_order_relaxed);
+        if (max_size) {
+            evict(dir, max_size);
+        }
+    }
+    return code;
+}
+
+PyObject* QorePythonCodeCache::read(const std::string& path, const std::string& header) {
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) {
+        return nullptr;
+    }
+    // ignore files that could have been written by other users
+    struct stat sbuf;
+    if (fstat(fd, &sbuf) || !S_ISREG(sbuf.st_mode) || !is_trusted(sbuf)) {
+        printd(5, "QorePythonCodeCache::read() ignoring untrusted file '%s'\n", path.c_str());
+        close(fd);
+        return nullptr;
+    }
+    FILE* fp = fdopen(fd, "rb");
+    if (!fp) {
+        close(fd);
+        return nullptr;
+    }
+    std::string data;
+    char buf[16384];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof buf, fp)) > 0) {
+        data.append(buf, len);
+    }
+    bool err = ferror(fp);
+    fclose(fp);
+    if (err || data.size() <= header.size() || data.compare(0, header.size(), header)) {
+        return nullptr;
+    }
+
+    PyObject* code = PyMarshal_ReadObjectFromString(data.data() + header.size(), data.size() - header.size());
+    if (!code || !PyCode_Check(code)) {
+        Py_XDECREF(code);
+        PyErr_Clear();
+        return nullptr;
+    }
+    // update the modification time for eviction; ignore errors
+    utime(path.c_str(), nullptr);
+    printd(5, "QorePythonCodeCache::read() loaded '%s'\n", path.c_str());
+    return code;
+}
+
+int QorePythonCodeCache::write(const std::string& path, const std::string& header, PyObject* code) {
+    QorePythonReferenceHolder data(PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION));
+    if (!data || !PyBytes_Check(*data)) {
+        PyErr_Clear();
+        return -1;
+    }
+
+    // write to a unique temporary file and rename it into place, so readers never see partial files
+    QoreStringMaker tmp_path("%s.%d.%d.tmp", path.c_str(), (int)getpid(), q_gettid());
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (!fp) {
+        return -1;
+    }
+    size_t len = (size_t)PyBytes_GET_SIZE(*data);
+    bool ok = fwrite(header.data(), 1, header.size(), fp) == header.size()
+        && fwrite(PyBytes_AS_STRING(*data), 1, len, fp) == len;
+    if (fclose(fp) || !ok || rename(tmp_path.c_str(), path.c_str())) {
+        unlink(tmp_path.c_str());
+        return -1;
+    }
+    printd(5, "QorePythonCodeCache::write() wrote '%s'\n", path.c_str());
+    return 0;
+}
+
+void QorePythonCodeCache::evict(const std::string& dir, int64 max_size) {
+    DIR* dp = opendir(dir.c_str());
+    if (!dp) {
+        return;
+    }
+    std::vector<code_cache_file> files;
+    int64 total = 0;
+    size_t ext_len = strlen(QORE_PYTHON_CODE_CACHE_EXT);
+    struct dirent* de;
+    while ((de = readdir(dp))) {
+        size_t len = strlen(de->d_name);
+        if (len <= ext_len || strcmp(de->d_name + len - ext_len, QORE_PYTHON_CODE_CACHE_EXT)) {
+            continue;
+        }
+        std::string path = dir + "/" + de->d_name;
+        struct stat sbuf;
+        if (stat(path.c_str(), &sbuf)) {
+            continue;
+        }
+        files.push_back({path, sbuf.st_mtime, sbuf.st_size});
+        total += sbuf.st_size;
+    }
+    closedir(dp);
+
+    if (total <= max_size) {
+        return;
+    }
+
+    // remove the least recently used files first; files may be removed concurrently by other processes
+    std::sort(files.begin(), files.end(), [](const code_cache_file& a, const code_cache_file& b) {
+        return a.mtime < b.mtime;
+    });
+    for (auto& i : files) {
+        if (total <= max_size) {
+            break;
+        }
+        if (!unlink(i.path.c_str()) || errno == ENOENT) {
+            total -= i.size;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonCodeCache.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_QOREPYTHONCODECACHE_H
+
+#define _QORE_QOREPYTHONCODECACHE_H
+
+#include "python-module.h"
+
+#include <atomic>
+#include <string>
+
+//! optional on-disk cache for compiled code objects of inline Python source
+/** code objects are stored in marshaled form in files named after a hash of the source, source label, compile mode,
+    and Python bytecode magic number; files are written to a temporary file and renamed into place, so concurrent
+    writers in multiple processes are safe
+*/
+class QorePythonCodeCache {
+public:
+    //! sets the cache directory and maximum size in bytes
+    /** @param dir the cache directory; created if it does not exist; nullptr or an empty string disables the cache
+        @param max_size the maximum size of all cache files in bytes; 0 = unlimited
+    */
+    DLLLOCAL static int setDirectory(ExceptionSink* xsink, const char* dir, int64 max_size);
+
+    //! sets the cache configuration from the environment, if present
+    DLLLOCAL static void initFromEnvironment();
+
+    //! returns a hash describing the cache configuration and statistics
+    DLLLOCAL static QoreHashNode* getInfo();
+
+    //! compiles the given source, using the cache if enabled; the GIL must be held
+    /** @return a new reference to the code object or nullptr with a Python exception set
+    */
+    DLLLOCAL static PyObject* compile(const char* src, const char* label, int start);
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+    DLLLOCAL static std::atomic<uint64_t> hits;
+    DLLLOCAL static std::atomic<uint64_t> misses;
+    DLLLOCAL static std::atomic<uint64_t> writes;
+
+    //! returns the cache directory and size limit; returns false if the cache is disabled
+    DLLLOCAL static bool getConfig(std::string& dir, int64& max_size);
+
+    //! reads a cached code object; returns a new reference or nullptr if not present or invalid
+    DLLLOCAL static PyObject* read(const std::string& path, const std::string& header);
+
+    //! writes a code object to the cache
+    DLLLOCAL static int write(const std::string& path, const std::string& header, PyObject* code);
+
+    //! removes the least recently used cache files until the total size is below the limit
+    DLLLOCAL static void evict(const std::string& dir, int64 max_size);
+};
+
+#endif
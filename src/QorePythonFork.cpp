@@ -0,0 +1,231 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonFork.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#include "QorePythonFork.h"
+#include "QorePythonProgram.h"
+#include "QorePythonReaper.h"
+#include "QorePythonSampler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+
+std::atomic<bool> QorePythonFork::enabled(false);
+
+namespace {
+//! fork hook state; the hook data is only accessed by the forking thread
+struct fork_data {
+    //! the GIL helper used if the GIL was not held by the forking thread
+    QorePythonGilHelper* gil = nullptr;
+    //! true if the Python runtime fork hooks must be run by the handlers (i.e. the fork was not made by os.fork())
+    bool run_hooks = false;
+    //! true if the hooks were active when the fork was prepared
+    bool active = false;
+    //! true if the handlers have been registered
+    bool registered = false;
+    //! true if this process was forked with the hooks active
+    bool child = false;
+    //! the number of forks made with the hooks active in this process
+    std::atomic<uint64_t> forks{0};
+};
+}
+
+static fork_data fork_state;
+
+static QoreThreadLock fork_lck;
+
+//! true while a fork initiated by Python with os.fork() is in progress in the current thread
+/** set and cleared by the handlers registered with os.register_at_fork() in each interpreter
+*/
+static thread_local bool python_fork = false;
+
+static PyObject* python_fork_before(PyObject* self, PyObject* args) {
+    python_fork = true;
+    Py_RETURN_NONE;
+}
+
+static PyObject* python_fork_after(PyObject* self, PyObject* args) {
+    python_fork = false;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef python_fork_before_def = {"_qore_fork_before", python_fork_before, METH_NOARGS, nullptr};
+static PyMethodDef python_fork_after_def = {"_qore_fork_after", python_fork_after, METH_NOARGS, nullptr};
+
+static void fork_prepare() {
+    if (!QorePythonFork::isEnabled() || python_shutdown || !mainThreadState) {
+        fork_state.active = false;
+        return;
+    }
+    fork_state.active = true;
+
+#if PY_VERSION_HEX >= 0x03070000
+    // must be checked before PyOS_BeforeFork() is called below, which also runs the os.register_at_fork() handlers
+    bool in_python_fork = python_fork;
+#else
+    // os.register_at_fork() is not available; a fork made with the GIL held is assumed to be made by os.fork()
+    bool in_python_fork = _qore_has_gil();
+#endif
+
+    // the GIL is always acquired before the global thread lock
+    fork_state.gil = _qore_has_gil() ? nullptr : new QorePythonGilHelper;
+    // os.fork() runs the Python runtime hooks itself
+    fork_state.run_hooks = !in_python_fork;
+#if PY_VERSION_HEX >= 0x03070000
+    if (fork_state.run_hooks) {
+        PyOS_BeforeFork();
+    }
+#endif
+    QorePythonProgram::lockForFork();
+}
+
+static void fork_parent() {
+    if (!fork_state.active) {
+        return;
+    }
+    QorePythonProgram::afterForkParent();
+#if PY_VERSION_HEX >= 0x03070000
+    if (fork_state.run_hooks) {
+        PyOS_AfterFork_Parent();
+    }
+#endif
+    if (fork_state.gil) {
+        delete fork_state.gil;
+        fork_state.gil = nullptr;
+    }
+    ++fork_state.forks;
+}
+
+static void fork_child() {
+    if (!fork_state.active) {
+        return;
+    }
+    // the current thread state is the only one that survives in the main interpreter
+    PyThreadState* tstate = _qore_PyRuntimeGILState_GetThreadState();
+    if (fork_state.run_hooks) {
+#if PY_VERSION_HEX >= 0x03070000
+        PyOS_AfterFork_Child();
+#else
+        PyOS_AfterFork();
+#endif
+    }
+    QorePythonReaper::afterForkChild();
+    QorePythonSampler::afterForkChild();
+    QorePythonProgram::afterForkChild(tstate);
+    if (fork_state.gil) {
+        delete fork_state.gil;
+        fork_state.gil = nullptr;
+    }
+    fork_state.child = true;
+    fork_state.forks = 0;
+}
+
+int QorePythonFork::setEnabled(ExceptionSink* xsink, bool enable) {
+    if (enable) {
+        AutoLocker al(fork_lck);
+        if (!fork_state.registered) {
+            int rc = pthread_atfork(fork_prepare, fork_parent, fork_child);
+            if (rc) {
+                if (xsink) {
+                    xsink->raiseErrnoException("PYTHON-FORK-ERROR", rc, "failed to register fork handlers");
+                }
+                return -1;
+            }
+            fork_state.registered = true;
+        }
+    }
+    enabled.store(enable, std::memory_order_relaxed);
+    return 0;
+}
+
+int QorePythonFork::registerInterpreter(QorePythonProgram* pypgm, ExceptionSink* xsink) {
+#if PY_VERSION_HEX >= 0x03070000
+    QorePythonReferenceHolder os(PyImport_ImportModule("os"));
+    if (!os) {
+        return raisePythonError(pypgm, xsink);
+    }
+    if (!PyObject_HasAttrString(*os, "register_at_fork")) {
+        // os.fork() is not available on this platform
+        return 0;
+    }
+    QorePythonReferenceHolder register_at_fork(PyObject_GetAttrString(*os, "register_at_fork"));
+    QorePythonReferenceHolder before(PyCFunction_New(&python_fork_before_def, nullptr));
+    QorePythonReferenceHolder after(PyCFunction_New(&python_fork_after_def, nullptr));
+    QorePythonReferenceHolder args(PyTuple_New(0));
+    QorePythonReferenceHolder kwargs(PyDict_New());
+    if (!register_at_fork || !before || !after || !args || !kwargs
+        || PyDict_SetItemString(*kwargs, "before", *before)
+        || PyDict_SetItemString(*kwargs, "after_in_parent", *after)
+        || PyDict_SetItemString(*kwargs, "after_in_child", *after)) {
+        return raisePythonError(pypgm, xsink);
+    }
+    QorePythonReferenceHolder rv(PyObject_Call(*register_at_fork, *args, *kwargs));
+    if (!rv) {
+        return raisePythonError(pypgm, xsink);
+    }
+#endif
+    return 0;
+}
+
+int QorePythonFork::raisePythonError(QorePythonProgram* pypgm, ExceptionSink* xsink) {
+    if (pypgm && xsink) {
+        if (!pypgm->checkPythonException(xsink)) {
+            xsink->raiseException("PYTHON-FORK-ERROR", "failed to register the os.fork() handlers");
+        }
+    } else {
+        PyErr_Clear();
+    }
+    return -1;
+}
+
+void QorePythonFork::initFromEnvironment() {
+    const char* val = getenv("QORE_PYTHON_FORK_HOOKS");
+    if (val && *val && strcmp(val, "0")) {
+        setEnabled(nullptr, true);
+    }
+}
+
+QoreHashNode* QorePythonFork::prepare(ExceptionSink* xsink, bool collect) {
+    return QorePythonProgram::freezeInterpreters(xsink, collect);
+}
+
+QoreHashNode* QorePythonFork::finish(ExceptionSink* xsink) {
+    return QorePythonProgram::freezeInterpreters(xsink, false, false);
+}
+
+QoreHashNode* QorePythonFork::getInfo() {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("enabled", isEnabled(), nullptr);
+    rv->setKeyValue("child", fork_state.child, nullptr);
+    rv->setKeyValue("forks", (int64)fork_state.forks.load(), nullptr);
+    return rv.release();
+}
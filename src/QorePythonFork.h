@@ -0,0 +1,88 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonFork.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#ifndef _QORE_QOREPYTHONFORK_H
+
+#define _QORE_QOREPYTHONFORK_H
+
+#include "python-module.h"
+
+#include <atomic>
+
+//! optional process fork hooks for the Python bridge
+/** when enabled, handlers registered with \c pthread_atfork() acquire the GIL and the global thread lock before a
+    fork and restore a consistent state in the parent and child afterwards; in the child, the thread-state registry
+    is reduced to the forking thread, programs whose interpreters were deleted by Python are invalidated, and the
+    background reaper and sampler threads are reset
+*/
+class QorePythonFork {
+public:
+    //! returns true if the fork hooks are enabled
+    DLLLOCAL static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    //! enables or disables the fork hooks; the handlers are registered the first time the hooks are enabled
+    DLLLOCAL static int setEnabled(ExceptionSink* xsink, bool enable);
+
+    //! registers handlers with \c os.register_at_fork() in the current interpreter to track forks made by Python
+    /** must be called with the GIL held in each new interpreter; does nothing with %Python 3.6
+
+        @param pypgm the program used to convert any Python exception, may be nullptr
+        @param xsink for Qore-language exceptions, may be nullptr, in which case any Python exception is cleared
+    */
+    DLLLOCAL static int registerInterpreter(QorePythonProgram* pypgm, ExceptionSink* xsink);
+
+    //! sets the configuration from the environment, if present
+    DLLLOCAL static void initFromEnvironment();
+
+    //! prepares for a fork by collecting garbage if requested and freezing all objects in all live interpreters
+    /** @return a hash with the number of interpreters processed, objects collected, and objects frozen
+    */
+    DLLLOCAL static QoreHashNode* prepare(ExceptionSink* xsink, bool collect);
+
+    //! moves all frozen objects in all live interpreters back to the oldest generation
+    /** @return a hash with the number of interpreters processed and the number of objects still frozen
+    */
+    DLLLOCAL static QoreHashNode* finish(ExceptionSink* xsink);
+
+    //! returns a hash describing the fork hook state
+    DLLLOCAL static QoreHashNode* getInfo();
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+
+    //! converts any Python exception to a Qore exception if possible, otherwise clears it; always returns -1
+    DLLLOCAL static int raisePythonError(QorePythonProgram* pypgm, ExceptionSink* xsink);
+};
+
+#endif
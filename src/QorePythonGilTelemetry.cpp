@@ -0,0 +1,274 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonGilTelemetry.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QorePythonGilTelemetry.h"
+#include "QorePythonProgram.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> QorePythonGilTelemetry::enabled(false);
+
+namespace {
+//! wait and hold statistics for a call site
+struct gil_site_info {
+    //! the number of times the GIL was released by the call site
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    //! the number of times the GIL was acquired for the call site
+    uint64_t acquisitions = 0;
+    uint64_t total_wait_ns = 0;
+    uint64_t max_wait_ns = 0;
+};
+
+typedef std::map<int, std::shared_ptr<QorePythonGilStats>> gil_thread_map_t;
+typedef std::map<std::string, gil_site_info> gil_site_map_t;
+
+//! global telemetry data
+struct gil_telemetry_data {
+    QorePythonGilStats global;
+    gil_thread_map_t thread_map;
+    gil_site_map_t site_map;
+    QoreThreadLock lck;
+};
+
+//! thread-local telemetry state
+struct gil_thread_data {
+    //! timestamp when the GIL was acquired, 0 if unknown
+    uint64_t acquired = 0;
+    //! call site when the GIL was acquired
+    std::string site;
+    //! per-thread statistics, also referenced in the global thread map
+    std::shared_ptr<QorePythonGilStats> stats;
+    //! the thread ID used as the key in the global thread map
+    int tid = 0;
+
+    //! removes the thread's entry from the global thread map when the thread exits
+    DLLLOCAL ~gil_thread_data();
+};
+}
+
+static gil_telemetry_data& get_data() {
+    // never destroyed to allow for use in thread-local destructors at exit
+    static gil_telemetry_data* data = new gil_telemetry_data;
+    return *data;
+}
+
+gil_thread_data::~gil_thread_data() {
+    if (stats) {
+        gil_telemetry_data& data = get_data();
+        AutoLocker al(data.lck);
+        gil_thread_map_t::iterator i = data.thread_map.find(tid);
+        // the thread ID may have been reused by a new thread already
+        if (i != data.thread_map.end() && i->second == stats) {
+            data.thread_map.erase(i);
+        }
+    }
+}
+
+static thread_local gil_thread_data gil_thread;
+static thread_local const std::string* gil_site = nullptr;
+
+static QorePythonGilStats* get_current_program_stats() {
+    QorePythonProgram* pypgm = (QorePythonProgram*)q_get_thread_local_data(python_u_tld_key);
+    return pypgm ? &pypgm->getGilStats() : nullptr;
+}
+
+static QorePythonGilStats& get_thread_stats() {
+    if (!gil_thread.stats) {
+        gil_thread.stats = std::make_shared<QorePythonGilStats>();
+        gil_thread.tid = q_gettid();
+        gil_telemetry_data& data = get_data();
+        AutoLocker al(data.lck);
+        data.thread_map[gil_thread.tid] = gil_thread.stats;
+    }
+    return *gil_thread.stats;
+}
+
+QoreHashNode* QorePythonGilStats::getHash() const {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("wait", wait.getHash(), nullptr);
+    rv->setKeyValue("hold", hold.getHash(), nullptr);
+    return rv.release();
+}
+
+void QorePythonGilTelemetry::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+void QorePythonGilTelemetry::acquired(QorePythonGilStats* pgm_stats, uint64_t start) {
+    uint64_t now = q_python_now_ns();
+    uint64_t wait = now - start;
+
+    if (!pgm_stats) {
+        pgm_stats = get_current_program_stats();
+    }
+    if (pgm_stats) {
+        pgm_stats->wait.add(wait);
+    }
+    get_thread_stats().wait.add(wait);
+    get_data().global.wait.add(wait);
+
+    gil_thread.acquired = now;
+    const std::string* site = QorePythonGilSiteHelper::getSite();
+    if (site) {
+        gil_thread.site = *site;
+        // the wait time is attributed to the call site on every acquisition, including the first one
+        gil_telemetry_data& data = get_data();
+        AutoLocker al(data.lck);
+        gil_site_info& info = data.site_map[gil_thread.site];
+        ++info.acquisitions;
+        info.total_wait_ns += wait;
+        if (wait > info.max_wait_ns) {
+            info.max_wait_ns = wait;
+        }
+    } else {
+        gil_thread.site.clear();
+    }
+}
+
+void QorePythonGilTelemetry::released(QorePythonGilStats* pgm_stats) {
+    // ignore if the GIL was acquired before telemetry was enabled
+    if (!gil_thread.acquired) {
+        return;
+    }
+    uint64_t hold = q_python_now_ns() - gil_thread.acquired;
+    gil_thread.acquired = 0;
+
+    if (!pgm_stats) {
+        pgm_stats = get_current_program_stats();
+    }
+    if (pgm_stats) {
+        pgm_stats->hold.add(hold);
+    }
+    get_thread_stats().hold.add(hold);
+
+    gil_telemetry_data& data = get_data();
+    data.global.hold.add(hold);
+
+    if (!gil_thread.site.empty()) {
+        AutoLocker al(data.lck);
+        gil_site_info& info = data.site_map[gil_thread.site];
+        ++info.count;
+        info.total_ns += hold;
+        if (hold > info.max_ns) {
+            info.max_ns = hold;
+        }
+    }
+}
+
+QoreHashNode* QorePythonGilTelemetry::getHash(int top) {
+    gil_telemetry_data& data = get_data();
+
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("enabled", isEnabled(), nullptr);
+    rv->setKeyValue("global", data.global.getHash(), nullptr);
+
+    ReferenceHolder<QoreHashNode> threads(new QoreHashNode(autoTypeInfo), nullptr);
+    typedef std::vector<std::pair<std::string, gil_site_info>> site_vec_t;
+    site_vec_t sites;
+    {
+        AutoLocker al(data.lck);
+        for (auto& i : data.thread_map) {
+            QoreStringMaker tid("%d", i.first);
+            threads->setKeyValue(tid.c_str(), i.second->getHash(), nullptr);
+        }
+        sites.assign(data.site_map.begin(), data.site_map.end());
+    }
+    rv->setKeyValue("threads", threads.release(), nullptr);
+
+    // sort by total hold time, longest first
+    std::sort(sites.begin(), sites.end(), [](const site_vec_t::value_type& a, const site_vec_t::value_type& b) {
+        return a.second.total_ns > b.second.total_ns;
+    });
+    if (top >= 0 && sites.size() > (size_t)top) {
+        sites.resize(top);
+    }
+
+    ReferenceHolder<QoreListNode> top_sites(new QoreListNode(autoTypeInfo), nullptr);
+    for (auto& i : sites) {
+        ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), nullptr);
+        h->setKeyValue("site", new QoreStringNode(i.first.c_str(), QCS_UTF8), nullptr);
+        h->setKeyValue("count", (int64)i.second.count, nullptr);
+        h->setKeyValue("total_hold_ns", (int64)i.second.total_ns, nullptr);
+        h->setKeyValue("avg_hold_ns", (int64)(i.second.count ? i.second.total_ns / i.second.count : 0), nullptr);
+        h->setKeyValue("max_hold_ns", (int64)i.second.max_ns, nullptr);
+        h->setKeyValue("acquisitions", (int64)i.second.acquisitions, nullptr);
+        h->setKeyValue("total_wait_ns", (int64)i.second.total_wait_ns, nullptr);
+        h->setKeyValue("max_wait_ns", (int64)i.second.max_wait_ns, nullptr);
+        top_sites->push(h.release(), nullptr);
+    }
+    rv->setKeyValue("top_sites", top_sites.release(), nullptr);
+    return rv.release();
+}
+
+void QorePythonGilTelemetry::reset() {
+    gil_telemetry_data& data = get_data();
+    data.global.reset();
+
+    AutoLocker al(data.lck);
+    for (gil_thread_map_t::iterator i = data.thread_map.begin(); i != data.thread_map.end();) {
+        // remove entries for threads that have terminated
+        if (i->second.use_count() == 1) {
+            data.thread_map.erase(i++);
+        } else {
+            i->second->reset();
+            ++i;
+        }
+    }
+    data.site_map.clear();
+}
+
+const std::string* QorePythonGilSiteHelper::getSite() {
+    return gil_site;
+}
+
+void QorePythonGilSiteHelper::set(const char* cls, const char* name) {
+    if (cls) {
+        site = cls;
+        site += "::";
+    }
+    site += name;
+    old_site = gil_site;
+    gil_site = &site;
+    active = true;
+    // if the GIL is already held without a call site, attribute the remaining hold time to this call site
+    if (gil_thread.acquired && gil_thread.site.empty()) {
+        gil_thread.site = site;
+    }
+}
+
+void QorePythonGilSiteHelper::restore() {
+    gil_site = old_site;
+}
@@ -0,0 +1,117 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonGilTelemetry.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_QOREPYTHONGILTELEMETRY_H
+
+#define _QORE_QOREPYTHONGILTELEMETRY_H
+
+#include "QorePythonStatistics.h"
+
+#include <string>
+
+//! GIL wait and hold time histograms
+struct QorePythonGilStats {
+    QorePythonHistogram wait;
+    QorePythonHistogram hold;
+
+    DLLLOCAL void reset() {
+        wait.reset();
+        hold.reset();
+    }
+
+    //! returns a hash with "wait" and "hold" keys
+    DLLLOCAL QoreHashNode* getHash() const;
+};
+
+//! optional GIL contention telemetry; all hooks are no-ops unless enabled
+class QorePythonGilTelemetry {
+public:
+    DLLLOCAL static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    DLLLOCAL static void setEnabled(bool enable);
+
+    //! returns the current timestamp if telemetry is enabled, otherwise 0
+    DLLLOCAL static uint64_t start() {
+        return isEnabled() ? q_python_now_ns() : 0;
+    }
+
+    //! called after the GIL has been acquired with the value returned by start()
+    /** @param pgm_stats the program's statistics; if nullptr, the current thread's program context is used
+    */
+    DLLLOCAL static void acquired(QorePythonGilStats* pgm_stats, uint64_t start);
+
+    //! called before the GIL is released
+    /** @param pgm_stats the program's statistics; if nullptr, the current thread's program context is used
+    */
+    DLLLOCAL static void released(QorePythonGilStats* pgm_stats);
+
+    //! returns global, per-thread, and top call site statistics
+    DLLLOCAL static QoreHashNode* getHash(int top);
+
+    //! resets all global and thread statistics
+    DLLLOCAL static void reset();
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+};
+
+//! sets the call site name for GIL hold statistics in the current thread
+/** the name is only built if telemetry is enabled
+*/
+class QorePythonGilSiteHelper {
+public:
+    DLLLOCAL QorePythonGilSiteHelper(const char* cls, const char* name) {
+        if (QorePythonGilTelemetry::isEnabled()) {
+            set(cls, name);
+        }
+    }
+
+    DLLLOCAL ~QorePythonGilSiteHelper() {
+        if (active) {
+            restore();
+        }
+    }
+
+    //! returns the call site for the current thread or nullptr if none
+    DLLLOCAL static const std::string* getSite();
+
+private:
+    std::string site;
+    const std::string* old_site = nullptr;
+    bool active = false;
+
+    DLLLOCAL void set(const char* cls, const char* name);
+    DLLLOCAL void restore();
+};
+
+#endif
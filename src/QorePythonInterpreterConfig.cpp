@@ -0,0 +1,300 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonInterpreterConfig.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#include "QorePythonInterpreterConfig.h"
+#include "QorePythonProgram.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+typedef std::vector<std::string> str_vec_t;
+
+//! interpreter configuration options
+struct interpreter_config {
+    //! do not import the site module
+    bool no_site = false;
+    //! create interpreters in isolated mode; the user site directory and the script directory are not added to
+    //! sys.path
+    bool isolated = false;
+    //! true if sys.path should be replaced with path
+    bool set_path = false;
+    str_vec_t path;
+    //! modules imported when the interpreter is created
+    str_vec_t preload;
+    //! PyInterpreterConfig flags; only used with Python 3.12+
+    bool allow_fork = true;
+    bool allow_exec = true;
+    bool allow_threads = true;
+    bool allow_daemon_threads = true;
+    bool check_multi_interp_extensions = false;
+};
+
+struct interpreter_config_data {
+    QoreThreadLock lck;
+    interpreter_config config;
+};
+}
+
+static interpreter_config_data& get_data() {
+    // never destroyed to allow for use when the module is unloaded
+    static interpreter_config_data* data = new interpreter_config_data;
+    return *data;
+}
+
+static interpreter_config get_config() {
+    interpreter_config_data& d = get_data();
+    AutoLocker al(d.lck);
+    return d.config;
+}
+
+static int get_bool_opt(ExceptionSink* xsink, const QoreValue& val, const char* key, bool& opt) {
+    if (val.getType() != NT_BOOLEAN) {
+        xsink->raiseException("PYTHON-INTERPRETER-CONFIG-ERROR", "option '%s' requires a boolean value; got type "
+            "'%s' instead", key, val.getFullTypeName());
+        return -1;
+    }
+    opt = val.getAsBool();
+    return 0;
+}
+
+static int get_str_list_opt(ExceptionSink* xsink, const QoreValue& val, const char* key, str_vec_t& opt) {
+    if (val.getType() != NT_LIST) {
+        xsink->raiseException("PYTHON-INTERPRETER-CONFIG-ERROR", "option '%s' requires a list of strings; got "
+            "type '%s' instead", key, val.getFullTypeName());
+        return -1;
+    }
+    ConstListIterator i(val.get<const QoreListNode>());
+    while (i.next()) {
+        QoreValue v = i.getValue();
+        if (v.getType() != NT_STRING) {
+            xsink->raiseException("PYTHON-INTERPRETER-CONFIG-ERROR", "option '%s' requires a list of strings; got "
+                "type '%s' in element %d", key, v.getFullTypeName(), (int)i.index());
+            return -1;
+        }
+        TempEncodingHelper str(v.get<const QoreStringNode>(), QCS_UTF8, xsink);
+        if (*xsink) {
+            return -1;
+        }
+        opt.push_back(str->c_str());
+    }
+    return 0;
+}
+
+int QorePythonInterpreterConfig::set(ExceptionSink* xsink, const QoreHashNode* config) {
+    interpreter_config new_config;
+    ConstHashIterator i(config);
+    while (i.next()) {
+        const char* key = i.getKey();
+        QoreValue val = i.get();
+        int rc;
+        if (!strcmp(key, "no_site")) {
+            rc = get_bool_opt(xsink, val, key, new_config.no_site);
+        } else if (!strcmp(key, "isolated")) {
+            rc = get_bool_opt(xsink, val, key, new_config.isolated);
+        } else if (!strcmp(key, "path")) {
+            new_config.set_path = true;
+            rc = get_str_list_opt(xsink, val, key, new_config.path);
+        } else if (!strcmp(key, "preload")) {
+            rc = get_str_list_opt(xsink, val, key, new_config.preload);
+        } else if (!strcmp(key, "allow_fork")) {
+            rc = get_bool_opt(xsink, val, key, new_config.allow_fork);
+        } else if (!strcmp(key, "allow_exec")) {
+            rc = get_bool_opt(xsink, val, key, new_config.allow_exec);
+        } else if (!strcmp(key, "allow_threads")) {
+            rc = get_bool_opt(xsink, val, key, new_config.allow_threads);
+        } else if (!strcmp(key, "allow_daemon_threads")) {
+            rc = get_bool_opt(xsink, val, key, new_config.allow_daemon_threads);
+        } else if (!strcmp(key, "check_multi_interp_extensions")) {
+            rc = get_bool_opt(xsink, val, key, new_config.check_multi_interp_extensions);
+        } else {
+            xsink->raiseException("PYTHON-INTERPRETER-CONFIG-ERROR", "unknown interpreter configuration option '%s'",
+                key);
+            rc = -1;
+        }
+        if (rc) {
+            return -1;
+        }
+    }
+
+    interpreter_config_data& d = get_data();
+    AutoLocker al(d.lck);
+    d.config = std::move(new_config);
+    return 0;
+}
+
+static QoreListNode* get_str_list(const str_vec_t& vec) {
+    QoreListNode* rv = new QoreListNode(stringTypeInfo);
+    for (auto& i : vec) {
+        rv->push(new QoreStringNode(i.c_str(), QCS_UTF8), nullptr);
+    }
+    return rv;
+}
+
+QoreHashNode* QorePythonInterpreterConfig::get() {
+    interpreter_config config = get_config();
+
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("no_site", config.no_site, nullptr);
+    rv->setKeyValue("isolated", config.isolated, nullptr);
+    if (config.set_path) {
+        rv->setKeyValue("path", get_str_list(config.path), nullptr);
+    }
+    rv->setKeyValue("preload", get_str_list(config.preload), nullptr);
+    rv->setKeyValue("allow_fork", config.allow_fork, nullptr);
+    rv->setKeyValue("allow_exec", config.allow_exec, nullptr);
+    rv->setKeyValue("allow_threads", config.allow_threads, nullptr);
+    rv->setKeyValue("allow_daemon_threads", config.allow_daemon_threads, nullptr);
+    rv->setKeyValue("check_multi_interp_extensions", config.check_multi_interp_extensions, nullptr);
+    return rv.release();
+}
+
+PyThreadState* QorePythonInterpreterConfig::newInterpreter() {
+#if PY_VERSION_HEX >= 0x030C0000
+    interpreter_config config = get_config();
+    PyInterpreterConfig py_config = {};
+    // objects are shared between interpreters, so the main allocator and the main GIL must be used
+    py_config.use_main_obmalloc = 1;
+    py_config.gil = PyInterpreterConfig_SHARED_GIL;
+    py_config.allow_fork = config.allow_fork;
+    py_config.allow_exec = config.allow_exec;
+    py_config.allow_threads = config.allow_threads;
+    py_config.allow_daemon_threads = config.allow_daemon_threads;
+    py_config.check_multi_interp_extensions = config.check_multi_interp_extensions;
+    PyThreadState* python = nullptr;
+    PyStatus status = Py_NewInterpreterFromConfig(&python, &py_config);
+    if (PyStatus_Exception(status)) {
+        return nullptr;
+    }
+    return python;
+#else
+    return Py_NewInterpreter();
+#endif
+}
+
+//! removes the given path from sys.path if present
+static int remove_sys_path(PyObject* sys_path, PyObject* dir) {
+    Py_ssize_t i = PySequence_Index(sys_path, dir);
+    if (i < 0) {
+        PyErr_Clear();
+        return 0;
+    }
+    return PySequence_DelItem(sys_path, i);
+}
+
+//! applies the site options to a new interpreter
+/** the site module is always imported by Py_NewInterpreter(), and the main interpreter's configuration is shared
+    by all threads, so the options are applied to \c sys.path after the interpreter has been created
+*/
+static int setup_site(const interpreter_config& config) {
+    // returns a borrowed reference
+    PyObject* site = PyDict_GetItemString(PyImport_GetModuleDict(), "site");
+    if (!site) {
+        return 0;
+    }
+#if PY_VERSION_HEX >= 0x03090000
+    if (config.no_site && !config.set_path) {
+        // restore the module search path from before site processing
+        const PyConfig* main_config = _PyInterpreterState_GetConfig(PyInterpreterState_Main());
+        QorePythonReferenceHolder path(PyList_New(main_config->module_search_paths.length));
+        if (!path) {
+            return -1;
+        }
+        for (Py_ssize_t i = 0; i < main_config->module_search_paths.length; ++i) {
+            PyObject* str = PyUnicode_FromWideChar(main_config->module_search_paths.items[i], -1);
+            if (!str) {
+                return -1;
+            }
+            // steals the reference
+            PyList_SET_ITEM(*path, i, str);
+        }
+        if (PySys_SetObject("path", *path)) {
+            return -1;
+        }
+    }
+#endif
+    if (config.isolated) {
+        // the user site directory is only set if it was added to sys.path
+        QorePythonReferenceHolder user_site(PyObject_GetAttrString(site, "USER_SITE"));
+        if (!user_site) {
+            return -1;
+        }
+        // returns a borrowed reference
+        PyObject* sys_path = PySys_GetObject("path");
+        if (PyUnicode_Check(*user_site) && sys_path && remove_sys_path(sys_path, *user_site)) {
+            return -1;
+        }
+        if (PyObject_SetAttrString(site, "ENABLE_USER_SITE", Py_False)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int QorePythonInterpreterConfig::setupInterpreter(QorePythonProgram* pypgm, ExceptionSink* xsink) {
+    interpreter_config config = get_config();
+    if ((config.no_site || config.isolated) && setup_site(config)) {
+        pypgm->checkPythonException(xsink);
+        return -1;
+    }
+    if (config.set_path) {
+        QorePythonReferenceHolder path(PyList_New(config.path.size()));
+        if (!path) {
+            pypgm->checkPythonException(xsink);
+            return -1;
+        }
+        for (size_t i = 0; i < config.path.size(); ++i) {
+            PyObject* str = PyUnicode_FromStringAndSize(config.path[i].c_str(), config.path[i].size());
+            if (!str) {
+                pypgm->checkPythonException(xsink);
+                return -1;
+            }
+            // steals the reference
+            PyList_SET_ITEM(*path, i, str);
+        }
+        if (PySys_SetObject("path", *path)) {
+            pypgm->checkPythonException(xsink);
+            return -1;
+        }
+    }
+
+    for (auto& i : config.preload) {
+        QorePythonReferenceHolder mod(PyImport_ImportModule(i.c_str()));
+        if (!mod) {
+            pypgm->checkPythonException(xsink);
+            xsink->appendLastDescription(" (while importing preloaded module '%s')", i.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
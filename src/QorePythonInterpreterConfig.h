@@ -0,0 +1,65 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonInterpreterConfig.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#ifndef _QORE_QOREPYTHONINTERPRETERCONFIG_H
+
+#define _QORE_QOREPYTHONINTERPRETERCONFIG_H
+
+#include "python-module.h"
+
+class QorePythonProgram;
+
+//! process-wide configuration for new Python subinterpreters
+/** allows new interpreters to be created without \c site processing, in isolated mode, with a restricted
+    \c sys.path, and with a list of modules imported when the interpreter is created; on Python 3.12+ the
+    \c PyInterpreterConfig flags can also be set
+*/
+class QorePythonInterpreterConfig {
+public:
+    //! sets the configuration for interpreters created afterwards; an empty hash restores the defaults
+    DLLLOCAL static int set(ExceptionSink* xsink, const QoreHashNode* config);
+
+    //! returns the current configuration
+    DLLLOCAL static QoreHashNode* get();
+
+    //! creates a new subinterpreter with the current configuration; the GIL must be held
+    /** interpreter creation must be serialized by the caller
+
+        @return the new interpreter's thread state, which is the current thread state, or nullptr on error
+    */
+    DLLLOCAL static PyThreadState* newInterpreter();
+
+    //! sets sys.path and imports the configured modules in the new interpreter; the GIL must be held
+    DLLLOCAL static int setupInterpreter(QorePythonProgram* pypgm, ExceptionSink* xsink);
+};
+
+#endif
@@ -0,0 +1,155 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonProfiler.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QorePythonProfiler.h"
+
+#include <algorithm>
+#include <vector>
+
+static thread_local QorePythonProfileHelper* current_frame = nullptr;
+
+static const char* dir_names[] = {
+    "qore-to-python",
+    "python-to-qore",
+};
+
+void QorePythonProfileEntry::reset() {
+    count.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    self_ns.store(0, std::memory_order_relaxed);
+    conv_ns.store(0, std::memory_order_relaxed);
+    latency.reset();
+}
+
+QorePythonProfileEntry* QorePythonProfiler::getEntry(qore_python_profile_dir_e dir, const std::string& name) {
+    AutoLocker al(lck);
+    std::unique_ptr<QorePythonProfileEntry>& entry = entry_map[key_t(dir, name)];
+    if (!entry) {
+        entry.reset(new QorePythonProfileEntry);
+    }
+    return entry.get();
+}
+
+QoreListNode* QorePythonProfiler::getReport(int top) const {
+    typedef std::vector<std::pair<const key_t*, const QorePythonProfileEntry*>> entry_vec_t;
+    entry_vec_t entries;
+    {
+        AutoLocker al(lck);
+        for (auto& i : entry_map) {
+            if (i.second->count.load(std::memory_order_relaxed)) {
+                entries.push_back(std::make_pair(&i.first, i.second.get()));
+            }
+        }
+    }
+
+    // sort by total time, longest first
+    std::sort(entries.begin(), entries.end(), [](const entry_vec_t::value_type& a,
+        const entry_vec_t::value_type& b) {
+        return a.second->total_ns.load(std::memory_order_relaxed)
+            > b.second->total_ns.load(std::memory_order_relaxed);
+    });
+    if (top >= 0 && entries.size() > (size_t)top) {
+        entries.resize(top);
+    }
+
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(autoTypeInfo), nullptr);
+    for (auto& i : entries) {
+        const QorePythonProfileEntry& e = *i.second;
+        uint64_t count = e.count.load(std::memory_order_relaxed);
+        uint64_t total = e.total_ns.load(std::memory_order_relaxed);
+
+        ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), nullptr);
+        h->setKeyValue("symbol", new QoreStringNode(i.first->second.c_str(), QCS_UTF8), nullptr);
+        h->setKeyValue("direction", new QoreStringNode(dir_names[i.first->first]), nullptr);
+        h->setKeyValue("count", (int64)count, nullptr);
+        h->setKeyValue("total_ns", (int64)total, nullptr);
+        h->setKeyValue("self_ns", (int64)e.self_ns.load(std::memory_order_relaxed), nullptr);
+        h->setKeyValue("conversion_ns", (int64)e.conv_ns.load(std::memory_order_relaxed), nullptr);
+        h->setKeyValue("avg_ns", (int64)(count ? total / count : 0), nullptr);
+        h->setKeyValue("latency", e.latency.getHash(), nullptr);
+        rv->push(h.release(), nullptr);
+    }
+    return rv.release();
+}
+
+void QorePythonProfiler::reset() {
+    AutoLocker al(lck);
+    for (auto& i : entry_map) {
+        i.second->reset();
+    }
+}
+
+QorePythonProfileHelper* QorePythonProfileHelper::getCurrent() {
+    return current_frame;
+}
+
+void QorePythonProfileHelper::enter(QorePythonProfiler& prof, qore_python_profile_dir_e dir,
+        const std::string& name) {
+    entry = prof.getEntry(dir, name);
+    parent = current_frame;
+    current_frame = this;
+    start = q_python_now_ns();
+}
+
+void QorePythonProfileHelper::exit() {
+    uint64_t total = q_python_now_ns() - start;
+    uint64_t excl = child_ns + conv_ns;
+    entry->count.fetch_add(1, std::memory_order_relaxed);
+    entry->total_ns.fetch_add(total, std::memory_order_relaxed);
+    entry->self_ns.fetch_add(total > excl ? total - excl : 0, std::memory_order_relaxed);
+    entry->conv_ns.fetch_add(conv_ns, std::memory_order_relaxed);
+    entry->latency.add(total);
+
+    if (parent) {
+        parent->child_ns += total;
+    }
+    current_frame = parent;
+}
+
+std::string QorePythonProfileHelper::getPythonName(PyObject* callable) {
+    std::string rv;
+    // returns a new reference
+    QorePythonReferenceHolder mod(PyObject_GetAttrString(callable, "__module__"));
+    if (mod && PyUnicode_Check(*mod)) {
+        rv = PyUnicode_AsUTF8(*mod);
+        rv += ".";
+    }
+    // returns a new reference
+    QorePythonReferenceHolder qname(PyObject_GetAttrString(callable, "__qualname__"));
+    if (qname && PyUnicode_Check(*qname)) {
+        rv += PyUnicode_AsUTF8(*qname);
+    } else {
+        rv += Py_TYPE(callable)->tp_name;
+    }
+    // ignore any errors retrieving attributes
+    PyErr_Clear();
+    return rv;
+}
@@ -0,0 +1,181 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonProfiler.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_QOREPYTHONPROFILER_H
+
+#define _QORE_QOREPYTHONPROFILER_H
+
+#include "python-module.h"
+#include "QorePythonStatistics.h"
+#include "QorePythonSampler.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+//! call direction for profiled boundary symbols
+enum qore_python_profile_dir_e : unsigned {
+    QPPD_TO_PYTHON = 0,     //!< Python callable called from Qore
+    QPPD_TO_QORE,           //!< Qore function or method called from Python
+};
+
+//! profile data for a single boundary symbol
+struct QorePythonProfileEntry {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> self_ns;
+    std::atomic<uint64_t> conv_ns;
+    QorePythonHistogram latency;
+
+    DLLLOCAL QorePythonProfileEntry() {
+        reset();
+    }
+
+    DLLLOCAL void reset();
+};
+
+//! opt-in per-program profiler for calls across the Qore / Python boundary
+class QorePythonProfiler {
+public:
+    DLLLOCAL QorePythonProfiler() : enabled(false) {
+    }
+
+    DLLLOCAL bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    DLLLOCAL void setEnabled(bool enable) {
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    //! returns the entry for the given symbol, creating it if necessary
+    /** entries are never deleted, so the pointer returned remains valid for the lifetime of the profiler
+    */
+    DLLLOCAL QorePythonProfileEntry* getEntry(qore_python_profile_dir_e dir, const std::string& name);
+
+    //! returns a list of the top symbols sorted by total time; if top is negative, all symbols are returned
+    DLLLOCAL QoreListNode* getReport(int top) const;
+
+    //! resets all profile data
+    DLLLOCAL void reset();
+
+private:
+    typedef std::pair<qore_python_profile_dir_e, std::string> key_t;
+    typedef std::map<key_t, std::unique_ptr<QorePythonProfileEntry>> entry_map_t;
+
+    std::atomic<bool> enabled;
+    mutable QoreThreadLock lck;
+    entry_map_t entry_map;
+};
+
+//! records a boundary call in the current thread for the profiler and the sampler; no-op if both are disabled
+/** must be created and destroyed with the GIL held
+*/
+class QorePythonProfileHelper {
+public:
+    //! profiles a Python callable called from Qore
+    DLLLOCAL QorePythonProfileHelper(QorePythonProfiler& prof, PyObject* callable) {
+        if (QorePythonSampler::isActive()) {
+            sampled = QorePythonSampler::push(nullptr, nullptr);
+        }
+        if (prof.isEnabled()) {
+            enter(prof, QPPD_TO_PYTHON, getPythonName(callable));
+        }
+    }
+
+    //! profiles a Qore function or method called from Python
+    DLLLOCAL QorePythonProfileHelper(QorePythonProfiler& prof, const char* cls, const char* name) {
+        if (QorePythonSampler::isActive()) {
+            sampled = QorePythonSampler::push(cls, name);
+        }
+        if (prof.isEnabled()) {
+            std::string sym;
+            if (cls) {
+                sym = cls;
+                sym += "::";
+            }
+            sym += name;
+            enter(prof, QPPD_TO_QORE, sym);
+        }
+    }
+
+    DLLLOCAL ~QorePythonProfileHelper() {
+        if (entry) {
+            exit();
+        }
+        if (sampled) {
+            QorePythonSampler::pop();
+        }
+    }
+
+    //! returns the active profile frame for the current thread, if any
+    DLLLOCAL static QorePythonProfileHelper* getCurrent();
+
+private:
+    QorePythonProfileEntry* entry = nullptr;
+    QorePythonProfileHelper* parent = nullptr;
+    uint64_t start = 0;
+    //! total time of nested profiled calls
+    uint64_t child_ns = 0;
+    //! time spent converting values for this call
+    uint64_t conv_ns = 0;
+    //! true if a frame was pushed for the sampler
+    bool sampled = false;
+
+    DLLLOCAL void enter(QorePythonProfiler& prof, qore_python_profile_dir_e dir, const std::string& name);
+    DLLLOCAL void exit();
+
+    DLLLOCAL static std::string getPythonName(PyObject* callable);
+
+    friend class QorePythonProfileConvHelper;
+};
+
+//! attributes the time spent in its scope to the conversion time of the active profile frame
+class QorePythonProfileConvHelper {
+public:
+    DLLLOCAL QorePythonProfileConvHelper() : frame(QorePythonProfileHelper::getCurrent()) {
+        if (frame) {
+            start = q_python_now_ns();
+        }
+    }
+
+    DLLLOCAL ~QorePythonProfileConvHelper() {
+        if (frame) {
+            frame->conv_ns += q_python_now_ns() - start;
+        }
+    }
+
+private:
+    QorePythonProfileHelper* frame;
+    uint64_t start = 0;
+};
+
+#endif
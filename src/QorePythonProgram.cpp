@@ -32,10 +32,14 @@
 #include "PythonQoreCallable.h"
 #include "ModuleNamespace.h"
 #include "QorePythonStackLocationHelper.h"
+#include "QoreThreadAttachHelper.h"
+#include "QorePythonReaper.h"
+#include "QorePythonInterpreterConfig.h"
 
 #include <structmember.h>
 #include <frameobject.h>
 #include <datetime.h>
+#include <marshal.h>
 
 #include <vector>
 #include <string>
@@ -74,6 +78,11 @@ static bool _qore_PyThreadState_IsCurrent(PyThreadState* tstate) {
 QorePythonProgram::py_thr_map_t QorePythonProgram::py_thr_map;
 QorePythonProgram::py_global_tid_map_t QorePythonProgram::py_global_tid_map;
 QoreThreadLock QorePythonProgram::py_thr_lck;
+std::atomic<unsigned> QorePythonProgram::import_cache_gen(0);
+QoreNamespace* QorePythonProgram::builtins_ns = nullptr;
+QorePythonProgram::strset_t QorePythonProgram::builtins_name_set;
+QoreThreadLock QorePythonProgram::builtins_lck;
+QorePythonProgram::shared_interp_map_t QorePythonProgram::shared_interp_map;
 unsigned QorePythonProgram::pgm_count = 0;
 
 QorePythonProgram::QorePythonProgram() : save_object_callback(nullptr) {
@@ -103,12 +112,60 @@ QorePythonProgram::QorePythonProgram() : save_object_callback(nullptr) {
 }
 
 QorePythonProgram::QorePythonProgram(QoreProgram* qpgm, QoreNamespace* pyns)
-        : qpgm(qpgm), pyns(pyns), save_object_callback(nullptr) {
-    printd(5, "QorePythonProgram::QorePythonProgram() this: %p GIL thread state: %p\n", this,
-        PyGILState_GetThisThreadState());
+        : qpgm(qpgm), pyns(pyns), needs_init(true), save_object_callback(nullptr) {
+    printd(5, "QorePythonProgram::QorePythonProgram() this: %p (lazy)\n", this);
+#if QORE_VERSION_CODE >= 10013
+    // builtins must be resolvable before the interpreter is created; calls to builtin functions and builtin classes
+    // created on demand will create the interpreter
+    const QoreNamespace* bns = getBuiltinsNamespace();
+    if (bns && !pyns->findLocalNamespace("builtins")) {
+        pyns->addNamespace(bns->copy());
+        setLazyClassHandler("builtins");
+    }
+#endif
+}
+
+int QorePythonProgram::initInterpreter() {
     QorePythonGilHelper qpgh;
 
-    //printd(5, "QorePythonProgram::QorePythonProgram() GIL thread state: %p\n", PyGILState_GetThisThreadState());
+    int tid = q_gettid();
+    while (true) {
+        {
+            AutoLocker al(init_lck);
+            if (!needs_init.load(std::memory_order_acquire)) {
+                return valid ? 0 : -1;
+            }
+            if (!init_tid) {
+                init_tid = tid;
+                break;
+            }
+            // the interpreter is already available for reentrant calls while initializing
+            if (init_tid == tid) {
+                return 0;
+            }
+        }
+        // wait for the interpreter to be created in another thread with the GIL released
+        QorePythonReleaseGilHelper prgh;
+        AutoLocker al(init_lck);
+        while (init_tid) {
+            init_cond.wait(init_lck);
+        }
+    }
+
+    printd(5, "QorePythonProgram::initInterpreter() this: %p GIL thread state: %p\n", this,
+        PyGILState_GetThisThreadState());
+    initInterpreterIntern(qpgh);
+
+    AutoLocker al(init_lck);
+    init_tid = 0;
+    needs_init.store(false, std::memory_order_release);
+    init_cond.broadcast();
+    return valid ? 0 : -1;
+}
+
+void QorePythonProgram::initInterpreterIntern(QorePythonGilHelper& qpgh) {
+    //printd(5, "QorePythonProgram::initInterpreterIntern() GIL thread state: %p\n",
+    //  PyGILState_GetThisThreadState());
     ExceptionSink xsink;
     if (createInterpreter(qpgh, &xsink)) {
         valid = false;
@@ -120,7 +177,7 @@ QorePythonProgram::QorePythonProgram(QoreProgram* qpgm, QoreNamespace* pyns)
     module = PyImport_AddModule("__main__");
     module.py_ref();
 
-    import(&xsink, "builtins");
+    importBuiltins(&xsink);
     if (xsink) {
         valid = false;
         return;
@@ -145,7 +202,8 @@ QorePythonProgram::QorePythonProgram(QoreProgram* qpgm, QoreNamespace* pyns)
 }
 
 QorePythonProgram::QorePythonProgram(const QoreString& source_code, const QoreString& source_label, int start,
-        ExceptionSink* xsink) : save_object_callback(nullptr) {
+        ExceptionSink* xsink, const char* interp_name) : interp_name(interp_name ? interp_name : ""),
+        save_object_callback(nullptr) {
     printd(5, "QorePythonProgram::QorePythonProgram() this: %p\n", this);
     TempEncodingHelper src_code(source_code, QCS_UTF8, xsink);
     if (*xsink) {
@@ -158,10 +216,23 @@ QorePythonProgram::QorePythonProgram(const QoreString& source_code, const QoreSt
         return;
     }
 
-    //printd(5, "QorePythonProgram::QorePythonProgram() GIL thread state: %p\n", PyGILState_GetThisThreadState());
+    this->source_label = src_label->c_str();
+
+    QorePythonGilHelper qpgh;
+    initSourceIntern(qpgh, xsink, src_code->c_str(), start, nullptr);
+}
+
+QorePythonProgram::QorePythonProgram(const std::shared_ptr<const std::string>& code, const std::string& source_label,
+        const std::string& interp_name, ExceptionSink* xsink) : source_label(source_label), clone_code(code),
+        interp_name(interp_name), save_object_callback(nullptr) {
+    printd(5, "QorePythonProgram::QorePythonProgram() this: %p (clone)\n", this);
     QorePythonGilHelper qpgh;
+    initSourceIntern(qpgh, xsink, nullptr, 0, code.get());
+}
 
-    //printd(5, "QorePythonProgram::QorePythonProgram() GIL thread state: %p\n", PyGILState_GetThisThreadState());
+void QorePythonProgram::initSourceIntern(QorePythonGilHelper& qpgh, ExceptionSink* xsink, const char* src_code,
+        int start, const std::string* code) {
+    //printd(5, "QorePythonProgram::initSourceIntern() GIL thread state: %p\n", PyGILState_GetThisThreadState());
     if (createInterpreter(qpgh, xsink)) {
         return;
     }
@@ -176,8 +247,13 @@ QorePythonProgram::QorePythonProgram(const QoreString& source_code, const QoreSt
     }
     //printd(5, "QorePythonProgram::QorePythonProgram() loaded qoreloader: %p\n", *qoreloader);
 
-    // parse and compile code
-    python_code = (PyObject*)Py_CompileString(src_code->c_str(), src_label->c_str(), start);
+    if (code) {
+        // unmarshal the template's code object into this interpreter
+        python_code = PyMarshal_ReadObjectFromString(code->data(), code->size());
+    } else {
+        // parse and compile code
+        python_code = QorePythonCodeCache::compile(src_code, source_label.c_str(), start);
+    }
     if (!python_code) {
         if (!checkPythonException(xsink)) {
             xsink->raiseException("PYTHON-COMPILE-ERROR", "parsing and compilation failed");
@@ -188,7 +264,26 @@ QorePythonProgram::QorePythonProgram(const QoreString& source_code, const QoreSt
     assert(!module);
 
     // create module for code
-    QorePythonReferenceHolder new_module(PyImport_ExecCodeModule(src_label->c_str(), *python_code));
+    QorePythonReferenceHolder new_module;
+    if (interp_name.empty()) {
+        new_module = PyImport_ExecCodeModule(source_label.c_str(), *python_code);
+    } else {
+        // programs in a shared interpreter get a private module that is not added to sys.modules, so that programs
+        // with the same source label do not share module state
+        new_module = PyModule_New(source_label.c_str());
+        if (new_module) {
+            // returns a borrowed reference
+            PyObject* dict = PyModule_GetDict(*new_module);
+            if (PyDict_SetItemString(dict, "__builtins__", PyEval_GetBuiltins())) {
+                new_module.purge();
+            } else {
+                QorePythonReferenceHolder rv(PyEval_EvalCode(*python_code, dict, dict));
+                if (!rv) {
+                    new_module.purge();
+                }
+            }
+        }
+    }
     if (!new_module) {
         if (!checkPythonException(xsink)) {
             xsink->raiseException("PYTHON-COMPILE-ERROR", "compile failed");
@@ -213,6 +308,35 @@ QorePythonProgram::QorePythonProgram(const QoreString& source_code, const QoreSt
     // create Qore program object with the same restrictions as the parent
     //createQoreProgram();
     needs_deregistration = qpy_register(this);
+
+    // save the initial state for reset()
+    state_snapshot = PyDict_Copy(module_dict);
+    if (!state_snapshot && !checkPythonException(xsink)) {
+        xsink->raiseException("PYTHON-COMPILE-ERROR", "cannot save the initial state of the module dictionary");
+    }
+}
+
+std::shared_ptr<const std::string> QorePythonProgram::getCloneCode(ExceptionSink* xsink) {
+    QorePythonHelper qph(this);
+    if (checkValid(xsink)) {
+        return std::shared_ptr<const std::string>();
+    }
+    if (!python_code) {
+        xsink->raiseException("PYTHON-CLONE-ERROR", "only PythonProgram objects created from source can be cloned");
+        return std::shared_ptr<const std::string>();
+    }
+    // the GIL serializes access to clone_code
+    if (!clone_code) {
+        QorePythonReferenceHolder bytes(PyMarshal_WriteObjectToString(*python_code, Py_MARSHAL_VERSION));
+        if (!bytes) {
+            if (!checkPythonException(xsink)) {
+                xsink->raiseException("PYTHON-CLONE-ERROR", "cannot serialize the program's code");
+            }
+            return std::shared_ptr<const std::string>();
+        }
+        clone_code = std::make_shared<const std::string>(PyBytes_AS_STRING(*bytes), PyBytes_GET_SIZE(*bytes));
+    }
+    return clone_code;
 }
 
 int QorePythonProgram::setGlobalDictionary(PyObject* mod) {
@@ -293,6 +417,14 @@ void QorePythonProgram::deleteIntern(ExceptionSink* xsink) {
     if (needs_deregistration) {
         qpy_deregister(this);
     }
+    {
+        // never create the interpreter after the object has been destroyed
+        AutoLocker al(init_lck);
+        if (needs_init.load(std::memory_order_relaxed) && !init_tid) {
+            needs_init.store(false, std::memory_order_release);
+            valid = false;
+        }
+    }
 
     printd(5, "QorePythonProgram::deleteIntern() this: %p i: %p oi: %d\n", this, interpreter, owns_interpreter);
     if (q_libqore_exiting()) {
@@ -309,34 +441,45 @@ void QorePythonProgram::deleteIntern(ExceptionSink* xsink) {
     }
     qpgm = nullptr;
 
-    // remove all thread states; the objects will be deleted by Python when the interpreter is destroyed
+    // remove all thread states; the objects will be deleted by Python when the interpreter is destroyed, except for
+    // programs in a shared interpreter, where they are deleted explicitly below
+    bool shared = !interp_name.empty();
+    thr_state_vec_t thr_states;
+    // set if this program's class wrappers and arena must outlive it in a shared interpreter
+    bool retain = false;
+    // the shared interpreter entry if this program is the last user of the interpreter
+    std::unique_ptr<QorePythonSharedInterpreter> last_shared;
     {
         AutoLocker al(py_thr_lck);
         if (interpreter) {
             // wait for threads to complete before deleting entries
             waitForThreadsIntern();
 
-            py_thr_map_t::iterator i = py_thr_map.find(this);
-            assert(i != py_thr_map.end());
-            //printd(5, "QorePythonProgram::deleteIntern() this: %p removing all thread states for pgm (delta: %d)\n",
-            //  this, (int)i->second.size());
-            for (auto& ti : i->second) {
-                //printd(5, "QorePythonProgram::deleteIntern() this: %p removing TID %d\n", this, ti.first);
-                py_global_tid_map_t::iterator gi = py_global_tid_map.find(ti.first);
-                assert(gi != py_global_tid_map.end());
-                py_thr_set_t::iterator thr_i = gi->second.find(ti.second.state);
-                if (thr_i != gi->second.end()) {
-                    gi->second.erase(thr_i);
-                }
-            }
-            py_thr_map.erase(i);
+            assert(py_thr_map.find(this) != py_thr_map.end());
+            removeThreadStatesIntern(shared ? &thr_states : nullptr);
 
             assert(pgm_count > 0);
             --pgm_count;
+
+            if (shared) {
+                shared_interp_map_t::iterator i = shared_interp_map.find(interp_name);
+                assert(i != shared_interp_map.end());
+                assert(i->second.interp == interpreter);
+                if (--i->second.refs) {
+                    // Python types and functions created by this program can remain in sys.modules in the
+                    // interpreter; they are released when the interpreter is deleted
+                    weakRef();
+                    i->second.retained_vec.push_back(this);
+                    retain = true;
+                } else {
+                    last_shared.reset(new QorePythonSharedInterpreter(std::move(i->second)));
+                    shared_interp_map.erase(i);
+                }
+            }
         }
     }
 
-    if ((interpreter && owns_interpreter)) {
+    if (interpreter && (owns_interpreter || shared)) {
         {
             QorePythonHelper qph(this);
 
@@ -344,22 +487,37 @@ void QorePythonProgram::deleteIntern(ExceptionSink* xsink) {
                 Py_DECREF(i);
             }
 
-            for (auto& i : meth_vec) {
-                delete i;
-            }
-            meth_vec.clear();
-
             module.purge();
             python_code.purge();
-
-            for (auto& i : py_cls_map) {
-                delete i.second;
+            state_snapshot.purge();
+            spec_cache.purge();
+            purgeTimezoneCaches();
+            str_cache.purge();
+
+            if (!retain) {
+                deleteClasses();
+                if (last_shared) {
+                    for (QorePythonProgram* pypgm : last_shared->retained_vec) {
+                        pypgm->deleteClasses();
+                    }
+                }
             }
-            py_cls_map.clear();
 
             valid = false;
         }
-        if (interpreter && owns_interpreter) {
+        {
+            // remove the thread state created to release the objects above
+            AutoLocker al(py_thr_lck);
+            removeThreadStatesIntern(shared ? &thr_states : nullptr);
+        }
+        if (shared) {
+            releaseSharedInterpreter(thr_states, last_shared.get());
+        } else if (QorePythonReaper::isEnabled()) {
+            // the interpreter has already been removed from the thread-state registry; finalize it in the background
+            QorePythonReaper::queue(interpreter);
+            interpreter = nullptr;
+            owns_interpreter = false;
+        } else {
             // grab the GIL with the main thread lock
             QorePythonGilHelper pgh;
             {
@@ -383,8 +541,261 @@ void QorePythonProgram::deleteIntern(ExceptionSink* xsink) {
     //printd(5, "QorePythonProgram::deleteIntern() this: %p\n", this);
 }
 
+void QorePythonProgram::removeThreadStatesIntern(thr_state_vec_t* states) {
+    py_thr_map_t::iterator i = py_thr_map.find(this);
+    if (i == py_thr_map.end()) {
+        return;
+    }
+    //printd(5, "QorePythonProgram::removeThreadStatesIntern() this: %p removing all thread states for pgm "
+    //  "(delta: %d)\n", this, (int)i->second.size());
+    for (auto& ti : i->second) {
+        //printd(5, "QorePythonProgram::removeThreadStatesIntern() this: %p removing TID %d\n", this, ti.first);
+        py_global_tid_map_t::iterator gi = py_global_tid_map.find(ti.first);
+        assert(gi != py_global_tid_map.end());
+        py_thr_set_t::iterator thr_i = gi->second.find(ti.second.state);
+        if (thr_i != gi->second.end()) {
+            gi->second.erase(thr_i);
+        }
+        if (states) {
+            states->push_back(ti.second.state);
+        }
+    }
+    py_thr_map.erase(i);
+}
+
+PyThreadState* QorePythonProgram::getSharedInterpreterThreadStateIntern(bool& created) {
+    shared_interp_map_t::iterator i = shared_interp_map.lower_bound(interp_name);
+    PyThreadState* python;
+    if (i != shared_interp_map.end() && i->first == interp_name) {
+        python = PyThreadState_New(i->second.interp);
+        incStat(QPS_THREAD_STATES_CREATED);
+        created = false;
+    } else {
+        python = QorePythonInterpreterConfig::newInterpreter();
+        if (!python) {
+            return nullptr;
+        }
+        i = shared_interp_map.insert(i, shared_interp_map_t::value_type(interp_name, {python->interp, 0, {}}));
+    }
+    ++i->second.refs;
+    printd(5, "QorePythonProgram::getSharedInterpreterThreadStateIntern() this: %p '%s' interpreter: %p refs: %d\n",
+        this, interp_name.c_str(), i->second.interp, i->second.refs);
+    return python;
+}
+
+void QorePythonProgram::releaseSharedInterpreter(const thr_state_vec_t& thr_states,
+        QorePythonSharedInterpreter* last) {
+    // grab the GIL with the main thread lock
+    QorePythonGilHelper pgh;
+
+    // other programs continue to use the interpreter, so this program's thread states must be deleted explicitly
+    for (PyThreadState* state : thr_states) {
+        PyThreadState_Clear(state);
+        PyThreadState_Delete(state);
+    }
+
+    PyInterpreterState* interp = last ? interpreter : nullptr;
+    std::set<QoreProgram*> pgm_set;
+    std::vector<QorePythonProgram*> retained_vec;
+    if (last) {
+        pgm_set.swap(last->pgm_set);
+        retained_vec.swap(last->retained_vec);
+    }
+    interpreter = nullptr;
+
+    // delete the interpreter with the last program
+    if (interp) {
+        // modules referring to pinned Qore programs or to the arenas of retained programs must be deleted before
+        // the programs are released
+        if (QorePythonReaper::isEnabled() && pgm_set.empty() && retained_vec.empty()) {
+            QorePythonReaper::queue(interp);
+        } else {
+            {
+                // enforce serialization
+                AutoLocker al(py_thr_lck);
+                PyInterpreterState_Clear(interp);
+            }
+            PyInterpreterState_Delete(interp);
+        }
+    }
+
+    if (!pgm_set.empty() || !retained_vec.empty()) {
+        // release the GIL before dereferencing Qore programs
+        QorePythonReleaseGilHelper rgh;
+        ExceptionSink xsink;
+        for (QoreProgram* pgm : pgm_set) {
+            pgm->deref(&xsink);
+        }
+        xsink.clear();
+        for (QorePythonProgram* pypgm : retained_vec) {
+            pypgm->weakDeref();
+        }
+    }
+}
+
+void QorePythonProgram::deleteClasses() {
+    for (auto& i : py_cls_map) {
+        delete i.second;
+    }
+    py_cls_map.clear();
+}
+
+void QorePythonProgram::pinQoreProgram() {
+    if (interp_name.empty() || !qpgm) {
+        return;
+    }
+    AutoLocker al(py_thr_lck);
+    shared_interp_map_t::iterator i = shared_interp_map.find(interp_name);
+    if (i != shared_interp_map.end() && i->second.pgm_set.insert(qpgm).second) {
+        qpgm->ref();
+        printd(5, "QorePythonProgram::pinQoreProgram() this: %p '%s' pinned pgm: %p\n", this, interp_name.c_str(),
+            qpgm);
+    }
+}
+
+QoreHashNode* QorePythonProgram::getSharedInterpreterInfo() {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(bigIntTypeInfo), nullptr);
+    AutoLocker al(py_thr_lck);
+    for (auto& i : shared_interp_map) {
+        rv->setKeyValue(i.first.c_str(), (int64)i.second.refs, nullptr);
+    }
+    return rv.release();
+}
+
+QoreHashNode* QorePythonProgram::freezeInterpreters(ExceptionSink* xsink, bool collect, bool freeze) {
+    // get a weak reference to one program for each live interpreter
+    std::vector<QorePythonProgram*> pgm_vec;
+    {
+        std::set<PyInterpreterState*> interp_set;
+        AutoLocker al(py_thr_lck);
+        for (auto& i : py_thr_map) {
+            QorePythonProgram* pypgm = const_cast<QorePythonProgram*>(i.first);
+            if (!pypgm->valid || !pypgm->interpreter || !interp_set.insert(pypgm->interpreter).second) {
+                continue;
+            }
+            pypgm->weakRef();
+            pgm_vec.push_back(pypgm);
+        }
+    }
+
+    int64 interpreters = 0;
+    int64 collected = 0;
+    int64 frozen = 0;
+    for (QorePythonProgram* pypgm : pgm_vec) {
+        if (!*xsink) {
+            QorePythonHelper qph(pypgm);
+            // the program may have been destroyed in the meantime
+            if (pypgm->valid) {
+                ++interpreters;
+                if (collect) {
+                    collected += PyGC_Collect();
+                }
+#if PY_VERSION_HEX >= 0x03070000
+                QorePythonReferenceHolder gc(PyImport_ImportModule("gc"));
+                if (!pypgm->checkPythonException(xsink)) {
+                    QorePythonReferenceHolder rv(PyObject_CallMethod(*gc, freeze ? "freeze" : "unfreeze",
+                        nullptr));
+                    if (!pypgm->checkPythonException(xsink)) {
+                        QorePythonReferenceHolder count(PyObject_CallMethod(*gc, "get_freeze_count", nullptr));
+                        if (!pypgm->checkPythonException(xsink)) {
+                            frozen += PyLong_AsLongLong(*count);
+                        }
+                    }
+                }
+#endif
+            }
+        }
+        pypgm->weakDeref();
+    }
+    if (*xsink) {
+        return nullptr;
+    }
+
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(bigIntTypeInfo), nullptr);
+    rv->setKeyValue("interpreters", interpreters, nullptr);
+    rv->setKeyValue("collected", collected, nullptr);
+    rv->setKeyValue("frozen", frozen, nullptr);
+    return rv.release();
+}
+
+void QorePythonProgram::invalidateAfterFork() {
+    obj_sink.clear();
+    module.release();
+    python_code.release();
+    state_snapshot.release();
+    spec_cache.release();
+    tz_zone_map.clear();
+    tz_obj_map.clear();
+    str_cache.abandon();
+    module_dict = nullptr;
+    builtin_dict = nullptr;
+    // the class wrappers reference Python objects; they are abandoned along with the objects
+    py_cls_map.clear();
+    interpreter = nullptr;
+    owns_interpreter = false;
+    valid = false;
+}
+
+void QorePythonProgram::afterForkChild(PyThreadState* tstate) {
+    // only the forking thread exists in the child; the global thread lock was acquired before the fork
+    int tid = q_gettid();
+    PyInterpreterState* main_interp = mainThreadState->interp;
+    for (py_thr_map_t::iterator i = py_thr_map.begin(); i != py_thr_map.end();) {
+        QorePythonProgram* pypgm = const_cast<QorePythonProgram*>(i->first);
+        // threads that were running in the program do not exist in the child
+        pypgm->pgm_thr_cnt = 0;
+        pypgm->pgm_thr_waiting = 0;
+#if PY_VERSION_HEX >= 0x03080000
+        // Python deletes all interpreters except the main interpreter in the child
+        if (pypgm->interpreter != main_interp) {
+            printd(5, "QorePythonProgram::afterForkChild() invalidating pgm %p\n", pypgm);
+            pypgm->invalidateAfterFork();
+            py_thr_map.erase(i++);
+            assert(pgm_count > 0);
+            --pgm_count;
+            continue;
+        }
+#endif
+        // only the forking thread's current thread state survives in the main interpreter; thread states for other
+        // threads are abandoned, as they have been or will be deleted by Python
+        for (py_tid_map_t::iterator ti = i->second.begin(); ti != i->second.end();) {
+            if (ti->first == tid && (ti->second.state == tstate || pypgm->interpreter != main_interp)) {
+                ++ti;
+            } else {
+                i->second.erase(ti++);
+            }
+        }
+        ++i;
+    }
+
+    // rebuild reverse lookups from the remaining thread states
+    py_global_tid_map.clear();
+    for (auto& i : py_thr_map) {
+        for (auto& ti : i.second) {
+            py_global_tid_map[ti.first].insert(ti.second.state);
+        }
+    }
+#if PY_VERSION_HEX >= 0x03080000
+    // retained programs are released with the shared interpreters, which do not exist in the child
+    for (auto& i : shared_interp_map) {
+        for (QorePythonProgram* pypgm : i.second.retained_vec) {
+            pypgm->invalidateAfterFork();
+            pypgm->weakDeref();
+        }
+    }
+    shared_interp_map.clear();
+#endif
+
+    // the main thread state is deleted by Python if it does not belong to the forking thread
+    if (tstate && tstate != mainThreadState && tstate->interp == main_interp) {
+        mainThreadState = tstate;
+    }
+
+    py_thr_lck.unlock();
+}
+
 QoreValue QorePythonProgram::eval(ExceptionSink* xsink, const QoreString& source_code, const QoreString& source_label,
-        int input, bool encapsulate) {
+        int input, bool encapsulate, bool use_code_cache) {
     TempEncodingHelper src_code(source_code, QCS_UTF8, xsink);
     if (*xsink) {
         xsink->appendLastDescription(" (while processing the \"source_code\" argument)");
@@ -407,7 +818,9 @@ QoreValue QorePythonProgram::eval(ExceptionSink* xsink, const QoreString& source
     {
         //printd(5, "QorePythonProgram::QorePythonProgram() GIL thread state: %p\n", PyGILState_GetThisThreadState());
         // parse and compile code
-        python_code = (PyObject*)Py_CompileString(src_code->c_str(), src_label->c_str(), input);
+        python_code = use_code_cache
+            ? QorePythonCodeCache::compile(src_code->c_str(), src_label->c_str(), input)
+            : (PyObject*)Py_CompileString(src_code->c_str(), src_label->c_str(), input);
         if (!python_code) {
             if (!checkPythonException(xsink)) {
                 xsink->raiseException("PYTHON-COMPILE-ERROR", "parsing and compilation failed");
@@ -417,7 +830,20 @@ QoreValue QorePythonProgram::eval(ExceptionSink* xsink, const QoreString& source
     }
 
     PyObject* main_dict;
-    if (encapsulate) {
+    // a temporary dictionary for encapsulated statements in a shared interpreter
+    QorePythonReferenceHolder tmp_dict;
+    if (encapsulate && !interp_name.empty()) {
+        // the __main__ module is shared by all programs in a shared interpreter, so declarations would be visible to
+        // other programs
+        tmp_dict = PyDict_New();
+        if (!tmp_dict || PyDict_SetItemString(*tmp_dict, "__builtins__", PyEval_GetBuiltins())) {
+            if (!checkPythonException(xsink)) {
+                xsink->raiseException("PYTHON-COMPILE-ERROR", "cannot create the evaluation dictionary");
+            }
+            return QoreValue();
+        }
+        main_dict = *tmp_dict;
+    } else if (encapsulate) {
         // returns a borrowed reference
         PyObject* main = PyImport_AddModule("__main__");
         // returns a borrowed reference
@@ -499,11 +925,15 @@ bool QorePythonProgram::haveGilUnlocked(PyThreadState* check_tstate) {
 int QorePythonProgram::createInterpreter(QorePythonGilHelper& qpgh, ExceptionSink* xsink) {
     assert(PyGILState_Check());
     PyThreadState* python;
+    // true if a new interpreter was created
+    bool created = true;
     {
         // enforce serialization
         AutoLocker al(py_thr_lck);
 
-        python = Py_NewInterpreter();
+        python = interp_name.empty()
+            ? QorePythonInterpreterConfig::newInterpreter()
+            : getSharedInterpreterThreadStateIntern(created);
 
         if (!python) {
             if (xsink) {
@@ -521,34 +951,49 @@ int QorePythonProgram::createInterpreter(QorePythonGilHelper& qpgh, ExceptionSin
     }
 
     interpreter = python->interp;
-    owns_interpreter = true;
+    // programs in a shared interpreter release it with releaseSharedInterpreter()
+    owns_interpreter = interp_name.empty();
     printd(5, "QorePythonProgram::createInterpreter() interpreter: %p\n", interpreter);
 
     // save thread state
     int tid = q_gettid();
-    AutoLocker al(py_thr_lck);
     {
-        py_thr_map_t::iterator ti = py_thr_map.lower_bound(this);
-        if (ti == py_thr_map.end() || ti->first != this) {
-            py_thr_map.insert(ti, {this, {{tid, {python, true}}}});
-        } else {
-            ti->second[tid] = {python, true};
+        AutoLocker al(py_thr_lck);
+        {
+            py_thr_map_t::iterator ti = py_thr_map.lower_bound(this);
+            if (ti == py_thr_map.end() || ti->first != this) {
+                py_thr_map.insert(ti, {this, {{tid, {python, true}}}});
+            } else {
+                ti->second[tid] = {python, true};
+            }
         }
-    }
-    {
-        py_global_tid_map_t::iterator i = py_global_tid_map.lower_bound(tid);
-        if (i == py_global_tid_map.end() || i->first != tid) {
-            py_global_tid_map.insert(i, {tid, {python}});
-        } else {
-            i->second.insert(python);
+        {
+            py_global_tid_map_t::iterator i = py_global_tid_map.lower_bound(tid);
+            if (i == py_global_tid_map.end() || i->first != tid) {
+                py_global_tid_map.insert(i, {tid, {python}});
+            } else {
+                i->second.insert(python);
+            }
+            //printd(5, "QorePythonProgram::createInterpreter() inserted TID %d -> %p\n", tid, python);
         }
-        //printd(5, "QorePythonProgram::createInterpreter() inserted TID %d -> %p\n", tid, python);
-    }
 
-    ++pgm_count;
+        ++pgm_count;
+    }
 
     //printd(5, "QorePythonProgram::createInterpreter() this: %p\n", this);
-    return setRecursionLimit(xsink);
+    if (setRecursionLimit(xsink)) {
+        return -1;
+    }
+    if (!created) {
+        return 0;
+    }
+    // forks made by os.fork() in the new interpreter must be recognized by the process fork handlers
+    if (QorePythonFork::registerInterpreter(this, xsink)) {
+        return -1;
+    }
+    // apply the interpreter configuration to new interpreters without holding the thread lock, as modules are
+    // imported
+    return QorePythonInterpreterConfig::setupInterpreter(this, xsink);
 }
 
 int QorePythonProgram::getRecursionLimit() {
@@ -595,7 +1040,8 @@ int QorePythonProgram::setRecursionLimit(ExceptionSink* xsink) {
 }
 
 QorePythonThreadInfo QorePythonProgram::setContext() const {
-    if (!valid) {
+    if (!valid || (needs_init.load(std::memory_order_acquire)
+        && const_cast<QorePythonProgram*>(this)->initInterpreter())) {
         return {nullptr, nullptr, nullptr, PyGILState_UNLOCKED, 0, false};
     }
 
@@ -604,6 +1050,7 @@ QorePythonThreadInfo QorePythonProgram::setContext() const {
     // create new thread state if necessary
     if (!python) {
         python = PyThreadState_New(interpreter);
+        incStat(QPS_THREAD_STATES_CREATED);
 
         printd(5, "QorePythonProgram::setContext() this: %p created new thread context: %p (py_thr_map: %p "
             "size: %d)\n", this, python, &py_thr_map, (int)py_thr_map.size());
@@ -641,6 +1088,7 @@ QorePythonThreadInfo QorePythonProgram::setContext() const {
     // the TSS state needs to be restored in any case
     PyThreadState* tss_state = PyGILState_GetThisThreadState();
     PyThreadState* t_state, * ceval_state;
+    bool stats_enabled = QorePythonStatistics::isEnabled();
 
     // set new TSS thread state
     if (tss_state != python) {
@@ -653,10 +1101,25 @@ QorePythonThreadInfo QorePythonProgram::setContext() const {
         ceval_state = _qore_PyCeval_SwapThreadState(python);
 
         g_state = PyGILState_LOCKED;
+        if (stats_enabled) {
+            addStat(QPS_CONTEXT_REENTRIES);
+        }
     } else {
         ceval_state = nullptr;
+        bool telemetry_enabled = QorePythonGilTelemetry::isEnabled();
+        uint64_t gil_start = (stats_enabled || telemetry_enabled) ? q_python_now_ns() : 0;
         PyEval_RestoreThread(python);
+        if (telemetry_enabled) {
+            QorePythonGilTelemetry::acquired(&gil_stats, gil_start);
+        }
         g_state = PyGILState_UNLOCKED;
+        if (stats_enabled) {
+            addStat(QPS_GIL_ACQUISITIONS);
+            addStat(QPS_GIL_WAIT_NS, q_python_now_ns() - gil_start);
+        }
+    }
+    if (stats_enabled) {
+        addStat(QPS_CONTEXT_ENTRIES);
     }
 
     t_state = _qore_PyRuntimeGILState_GetThreadState();
@@ -715,6 +1178,9 @@ void QorePythonProgram::releaseContext(const QorePythonThreadInfo& oldstate) con
     //printd(5, "QorePythonProgram::releaseContext() t_state: %p g_state: %d\n", oldstate.t_state, oldstate.g_state);
 
     if (oldstate.g_state == PyGILState_UNLOCKED) {
+        if (QorePythonGilTelemetry::isEnabled()) {
+            QorePythonGilTelemetry::released(&gil_stats);
+        }
         PyEval_ReleaseThread(python);
         // NOTE we cannot assert !PyGILState_Check() here, as we have released the GIL, and another thread may have
         // created a new interpreter, which will temporarily disbale the GIL check, which would cause
@@ -751,9 +1217,11 @@ PythonQoreClass* QorePythonProgram::findCreatePythonClass(const QoreClass& cls,
 struct func_capsule_t {
     const QoreExternalFunction& func;
     QorePythonProgram* py_pgm;
+    //! the Qore program providing the function; pinned by shared interpreters
+    QoreProgram* qpgm;
 
     DLLLOCAL func_capsule_t(const QoreExternalFunction& func, QorePythonProgram* py_pgm)
-            : func(func), py_pgm(py_pgm) {
+            : func(func), py_pgm(py_pgm), qpgm(py_pgm->getQoreProgram()) {
     }
 };
 
@@ -769,15 +1237,12 @@ int QorePythonProgram::importQoreFunctionToPython(PyObject* mod, const QoreExter
 
     QorePythonReferenceHolder capsule(PyCapsule_New((void*)fc.release(), nullptr, func_capsule_destructor));
 
-    std::unique_ptr<PyMethodDef> funcdef(new PyMethodDef);
+    PyMethodDef* funcdef = arena.create<PyMethodDef>();
     funcdef->ml_name = func.getName();
     funcdef->ml_meth = callQoreFunction;
     funcdef->ml_flags = METH_VARARGS;
-    funcdef->ml_doc = nullptr;
-
-    meth_vec.push_back(funcdef.get());
 
-    QorePythonReferenceHolder pyfunc(PyCFunction_New(funcdef.release(), *capsule));
+    QorePythonReferenceHolder pyfunc(PyCFunction_New(funcdef, *capsule));
     assert(pyfunc);
     if (PyObject_SetAttrString(mod, func.getName(), *pyfunc)) {
         assert(PyErr_Occurred());
@@ -813,17 +1278,19 @@ int QorePythonProgram::saveQoreObjectFromPython(const QoreValue& rv, ExceptionSi
     return saveQoreObjectFromPythonDefault(rv, xsink);
 }
 
-int QorePythonProgram::saveQoreObjectFromPythonDefault(const QoreValue& rv, ExceptionSink& xsink) {
-    QoreHashNode* data = qpgm->getThreadData();
-    assert(data);
-    const char* domain_name;
+const char* QorePythonProgram::getSaveDomain(const QoreHashNode* data) {
     // get key name where to save the data if possible
     QoreValue v = data->getKeyValue("_python_save");
     if (v.getType() != NT_STRING) {
-        domain_name = "_python_save";
-    } else {
-        domain_name = v.get<const QoreStringNode>()->c_str();
+        return "_python_save";
     }
+    return v.get<const QoreStringNode>()->c_str();
+}
+
+int QorePythonProgram::saveQoreObjectFromPythonDefault(const QoreValue& rv, ExceptionSink& xsink) {
+    QoreHashNode* data = qpgm->getThreadData();
+    assert(data);
+    const char* domain_name = getSaveDomain(data);
 
     QoreValue kv = data->getKeyValue(domain_name);
     // ignore operation if domain exists but is not a list
@@ -857,8 +1324,70 @@ int QorePythonProgram::saveQoreObjectFromPythonDefault(const QoreValue& rv, Exce
     return 0;
 }
 
+int QorePythonProgram::snapshot(ExceptionSink* xsink) {
+    QorePythonHelper qph(this);
+    if (checkValid(xsink)) {
+        return -1;
+    }
+    assert(module_dict);
+    QorePythonReferenceHolder copy(PyDict_Copy(module_dict));
+    if (!copy) {
+        checkPythonException(xsink);
+        return -1;
+    }
+    state_snapshot = copy.release();
+    return 0;
+}
+
+int QorePythonProgram::reset(ExceptionSink* xsink, bool collect) {
+    // drop objects saved for the current thread before acquiring the GIL, as their destructors may call Python code
+    if (!save_object_callback && qpgm) {
+        QoreHashNode* data = qpgm->getThreadData();
+        if (data) {
+            data->removeKey(getSaveDomain(data), xsink);
+            if (*xsink) {
+                return -1;
+            }
+        }
+    }
+
+    QorePythonHelper qph(this);
+    if (checkValid(xsink)) {
+        return -1;
+    }
+    if (!state_snapshot) {
+        xsink->raiseException("PYTHON-RESET-ERROR", "no state snapshot is available for this PythonProgram; call "
+            "PythonProgram::snapshot() first");
+        return -1;
+    }
+
+    // restore module-level names; objects no longer referenced are released here
+    assert(module_dict);
+    PyDict_Clear(module_dict);
+    if (PyDict_Update(module_dict, *state_snapshot)) {
+        checkPythonException(xsink);
+        return -1;
+    }
+
+    // clear per-job state
+    missing_mod_set.clear();
+    missing_ns_attr_set.clear();
+    for (const char* name : {"last_type", "last_value", "last_traceback"}) {
+        // deleting an attribute that is not set raises an exception
+        if (PySys_GetObject(name) && PySys_SetObject(name, nullptr)) {
+            PyErr_Clear();
+        }
+    }
+
+    if (collect) {
+        PyGC_Collect();
+    }
+    return 0;
+}
+
 void QorePythonProgram::raisePythonException(ExceptionSink& xsink) {
     assert(xsink);
+    incStat(QPS_EXCEPTIONS_TO_PYTHON);
     QoreValue err(xsink.getExceptionErr());
     QoreValue desc(xsink.getExceptionDesc());
     QoreValue arg(xsink.getExceptionArg());
@@ -967,16 +1496,89 @@ int QorePythonProgram::importQoreClassToPython(PyObject* mod, const QoreClass& c
     return 0;
 }
 
+int QorePythonProgram::importQoreSymbolToPython(PyObject* mod, QoreNamespace& ns, const char* name) {
+    // resolve symbols in the reverse order of importQoreToPython() so that the same symbol is imported
+    {
+        const QoreNamespace* sub_ns = ns.findLocalNamespace(name);
+        if (sub_ns) {
+            return importQoreNamespaceToPython(mod, *sub_ns);
+        }
+    }
+
+    {
+        QoreClass* qc = ns.findLocalClass(name);
+        if (!qc) {
+            // try to load the class dynamically
+            qc = ns.findLoadLocalClass(name);
+        }
+        if (qc) {
+            return importQoreClassToPython(mod, *qc, ns.getName());
+        }
+    }
+
+    {
+        const QoreExternalConstant* constant = ns.findLocalConstant(name);
+        if (constant) {
+            return importQoreConstantToPython(mod, *constant);
+        }
+    }
+
+    {
+        const QoreExternalFunction* func = ns.findLocalFunction(name);
+        if (func && !(func->getCodeFlags() & QCF_DEPRECATED)) {
+            return importQoreFunctionToPython(mod, *func);
+        }
+    }
+
+    return 1;
+}
+
+PyObject* QorePythonProgram::getQoreNamespaceSymbolList(const QoreNamespace& ns) {
+    strset_t names;
+
+    QoreNamespaceFunctionIterator fi(ns);
+    while (fi.next()) {
+        const QoreExternalFunction& func = fi.get();
+        if (!(func.getCodeFlags() & QCF_DEPRECATED)) {
+            names.insert(func.getName());
+        }
+    }
+
+    QoreNamespaceConstantIterator consti(ns);
+    while (consti.next()) {
+        names.insert(consti.get().getName());
+    }
+
+    QoreNamespaceClassIterator clsi(ns);
+    while (clsi.next()) {
+        names.insert(clsi.get().getName());
+    }
+
+    QoreNamespaceNamespaceIterator ni(ns);
+    while (ni.next()) {
+        names.insert(ni.get().getName());
+    }
+
+    QorePythonReferenceHolder rv(PyList_New(names.size()));
+    if (!rv) {
+        return nullptr;
+    }
+    Py_ssize_t i = 0;
+    for (const std::string& name : names) {
+        PyList_SET_ITEM(*rv, i++, PyUnicode_FromStringAndSize(name.c_str(), name.size()));
+    }
+    return rv.release();
+}
+
 int QorePythonProgram::importQoreNamespaceToPython(PyObject* mod, const QoreNamespace& ns) {
     //printd(5, "QorePythonProgram::importQoreNamespaceToPython() %s\n", ns.getName());
     assert(PyModule_Check(mod));
 
     QoreStringMaker nsname("%s.%s", PyModule_GetName(mod), ns.getName());
 
-    // create a submodule
+    // create a submodule; symbols are imported on demand by ModuleNamespace_getattro()
     QorePythonReferenceHolder new_mod(newModule(nsname.c_str(), &ns));
     printd(5, "QorePythonProgram::importQoreNamespaceToPython() (mod) created new module '%s'\n", nsname.c_str());
-    importQoreToPython(*new_mod, ns, nsname.c_str());
     if (PyObject_SetAttrString(mod, ns.getName(), *new_mod)) {
         return -1;
     }
@@ -1190,7 +1792,7 @@ void QorePythonProgram::exportClass(ExceptionSink* xsink, QoreString& arg) {
     }
 
     strset_t nsset;
-    addClassToNamespaceIntern(xsink, ns, (PyTypeObject*)*obj, strpath.back().c_str(), i, nsset);
+    addClassToNamespaceIntern(xsink, ns, (PyTypeObject*)*obj, strpath.back().c_str(), i, nsset, PCF_FULL_WALK);
 }
 
 void QorePythonProgram::addModulePath(ExceptionSink* xsink, QoreString& arg) {
@@ -1387,29 +1989,98 @@ DateTimeNode* QorePythonProgram::getQoreDateTimeFromDelta(PyObject* val) {
         PyDateTime_DELTA_GET_MICROSECONDS(val));
 }
 
-DateTimeNode* QorePythonProgram::getQoreDateTimeFromDateTime(PyObject* val) {
-    assert(PyDateTime_Check(val));
+//! maximum number of fixed-offset timezone objects cached per program
+static constexpr size_t QORE_PYTHON_TZ_CACHE_MAX = 64;
 
-    const AbstractQoreZoneInfo* zone = nullptr;
-    if (PyObject_HasAttrString(val, "tzinfo")) {
-        // get UTC offset for time
-        QorePythonReferenceHolder tzinfo(PyObject_GetAttrString(val, "tzinfo"));
-        if (tzinfo && PyTZInfo_Check(*tzinfo)) {
-            assert(PyObject_HasAttrString(*tzinfo, "utcoffset"));
-            QorePythonReferenceHolder utcoffset_func(PyObject_GetAttrString(*tzinfo, "utcoffset"));
-            assert(PyCallable_Check(*utcoffset_func));
-            QorePythonReferenceHolder args(PyTuple_New(1));
-            Py_INCREF(val);
-            PyTuple_SET_ITEM(*args, 0, val);
-
-            QorePythonReferenceHolder delta(PyEval_CallObject(*utcoffset_func, *args));
-            if (delta && PyDelta_Check(*delta)) {
-                zone = findCreateOffsetZone(PyDateTime_DELTA_GET_SECONDS(*delta));
-                //printd(5, "TZ RV: %p '%s' utcoffset: %d (%p)\n", *delta, Py_TYPE(*delta)->tp_name,
-                //  PyDateTime_DELTA_GET_SECONDS(*delta), zone);
-            }
+//! returns a borrowed reference to the tzinfo object of the given datetime or Py_None if it is naive
+static PyObject* get_datetime_tzinfo(PyObject* val) {
+#if PY_VERSION_HEX >= 0x030A0000
+    return PyDateTime_DATE_GET_TZINFO(val);
+#else
+    PyDateTime_DateTime* dt = reinterpret_cast<PyDateTime_DateTime*>(val);
+    return dt->hastzinfo ? dt->tzinfo : Py_None;
+#endif
+}
+
+const AbstractQoreZoneInfo* QorePythonProgram::getZoneFromTzinfo(PyObject* tzinfo, PyObject* val) {
+#if PY_VERSION_HEX >= 0x03070000
+    // the UTC offset of datetime.timezone objects does not depend on the time, so the zone can be cached
+    bool fixed = Py_TYPE(tzinfo) == Py_TYPE(PyDateTime_TimeZone_UTC);
+    if (fixed) {
+        tz_zone_map_t::iterator i = tz_zone_map.find(tzinfo);
+        if (i != tz_zone_map.end()) {
+            return i->second;
+        }
+    }
+#endif
+
+    QorePythonReferenceHolder delta(PyObject_CallMethod(tzinfo, "utcoffset", "O", val));
+    if (!delta || !PyDelta_Check(*delta)) {
+        PyErr_Clear();
+        return nullptr;
+    }
+    // negative offsets are stored as -1 days plus a positive number of seconds
+    const AbstractQoreZoneInfo* zone = findCreateOffsetZone(PyDateTime_DELTA_GET_DAYS(*delta) * 86400
+        + PyDateTime_DELTA_GET_SECONDS(*delta));
+
+#if PY_VERSION_HEX >= 0x03070000
+    if (fixed && tz_zone_map.size() < QORE_PYTHON_TZ_CACHE_MAX) {
+        Py_INCREF(tzinfo);
+        tz_zone_map[tzinfo] = zone;
+    }
+#endif
+    return zone;
+}
+
+PyObject* QorePythonProgram::getPythonTimezone(int utc_offset) {
+    tz_obj_map_t::iterator i = tz_obj_map.lower_bound(utc_offset);
+    if (i != tz_obj_map.end() && i->first == utc_offset) {
+        return i->second;
+    }
+
+    PyObject* tz;
+#if PY_VERSION_HEX >= 0x03070000
+    if (!utc_offset) {
+        tz = PyDateTime_TimeZone_UTC;
+        Py_INCREF(tz);
+    } else {
+        QorePythonReferenceHolder delta(PyDelta_FromDSU(0, utc_offset, 0));
+        if (!delta) {
+            return nullptr;
         }
+        tz = PyTimeZone_FromOffset(*delta);
+    }
+#else
+    QorePythonReferenceHolder delta(PyDelta_FromDSU(0, utc_offset, 0));
+    if (!delta) {
+        return nullptr;
+    }
+    QorePythonReferenceHolder dtmod(PyImport_ImportModule("datetime"));
+    tz = dtmod ? PyObject_CallMethod(*dtmod, "timezone", "O", *delta) : nullptr;
+#endif
+    if (!tz) {
+        return nullptr;
+    }
+    tz_obj_map.insert(i, tz_obj_map_t::value_type(utc_offset, tz));
+    return tz;
+}
+
+void QorePythonProgram::purgeTimezoneCaches() {
+    for (auto& i : tz_zone_map) {
+        Py_DECREF(i.first);
     }
+    tz_zone_map.clear();
+    for (auto& i : tz_obj_map) {
+        Py_DECREF(i.second);
+    }
+    tz_obj_map.clear();
+}
+
+DateTimeNode* QorePythonProgram::getQoreDateTimeFromDateTime(PyObject* val) {
+    assert(PyDateTime_Check(val));
+
+    PyObject* tzinfo = get_datetime_tzinfo(val);
+    const AbstractQoreZoneInfo* zone = tzinfo != Py_None ? getZoneFromTzinfo(tzinfo, val) : nullptr;
     return DateTimeNode::makeAbsolute(zone ? zone : currentTZ(), PyDateTime_GET_YEAR(val), PyDateTime_GET_MONTH(val),
         PyDateTime_GET_DAY(val), PyDateTime_DATE_GET_HOUR(val), PyDateTime_DATE_GET_MINUTE(val),
         PyDateTime_DATE_GET_SECOND(val), PyDateTime_DATE_GET_MICROSECOND(val));
@@ -1462,17 +2133,20 @@ QoreValue QorePythonProgram::getQoreValue(ExceptionSink* xsink, PyObject* val, p
         Py_TYPE(val)->tp_name);
     assert(PyDateTimeAPI);
     if (!val || val == Py_None) {
+        incConvToQore(QPC_NONE);
         return QoreValue();
     }
 
     // if this is already a Qore object, then return it
     if (PyQoreObject_Check(val)) {
+        incConvToQore(QPC_OBJECT);
         PyQoreObject* pyobj = reinterpret_cast<PyQoreObject*>(val);
         return pyobj->qobj ? pyobj->qobj->refSelf() : QoreValue();
     }
 
     PyTypeObject* type = Py_TYPE(val);
     if (type == &PyBool_Type) {
+        incConvToQore(QPC_BOOL);
         return QoreValue(val == Py_True);
     }
 
@@ -1488,62 +2162,84 @@ QoreValue QorePythonProgram::getQoreValue(ExceptionSink* xsink, PyObject* val, p
         if (len < 19 || (len == 19
             && ((!sign && strcmp(longstr, "9223372036854775807") <= 0)
                 || (sign && strcmp(longstr, "-9223372036854775808") <= 0)))) {
+            incConvToQore(QPC_INT);
             return strtoll(longstr, 0, 10);
         }
+        incConvToQore(QPC_NUMBER);
         return new QoreNumberNode(longstr);
     }
 
     if (type == &PyFloat_Type) {
+        incConvToQore(QPC_FLOAT);
         return QoreValue(PyFloat_AS_DOUBLE(val));
     }
 
     if (type == &PyUnicode_Type) {
         Py_ssize_t size;
         const char* str = PyUnicode_AsUTF8AndSize(val, &size);
+        incConvToQore(QPC_STRING);
+        incStat(QPS_BYTES_TO_QORE, size);
+        // interned strings such as identifiers and dictionary keys are likely to be converted repeatedly
+        if ((size_t)size <= QorePythonStringCache::MAX_VALUE_LEN && PyUnicode_CHECK_INTERNED(val)) {
+            return str_cache.getQoreString(val, str, size);
+        }
         return new QoreStringNode(str, size, QCS_UTF8);
     }
 
     if (type == &PyList_Type) {
+        incConvToQore(QPC_LIST);
         return getQoreListFromList(xsink, val, rset);
     }
 
     if (type == &PyTuple_Type) {
+        incConvToQore(QPC_LIST);
         return getQoreListFromTuple(xsink, val, rset);
     }
 
     if (type == &PyBytes_Type) {
+        incConvToQore(QPC_BINARY);
+        incStat(QPS_BYTES_TO_QORE, PyBytes_Size(val));
         return getQoreBinaryFromBytes(val);
     }
 
     if (type == &PyByteArray_Type) {
+        incConvToQore(QPC_BINARY);
+        incStat(QPS_BYTES_TO_QORE, PyByteArray_Size(val));
         return getQoreBinaryFromByteArray(val);
     }
 
     if (type == PyDateTimeAPI->DateType) {
+        incConvToQore(QPC_DATE);
         return getQoreDateTimeFromDate(val);
     }
 
     if (type == PyDateTimeAPI->TimeType) {
+        incConvToQore(QPC_DATE);
         return getQoreDateTimeFromTime(val);
     }
 
     if (type == PyDateTimeAPI->DateTimeType) {
+        incConvToQore(QPC_DATE);
         return getQoreDateTimeFromDateTime(val);
     }
 
     if (type == PyDateTimeAPI->DeltaType) {
+        incConvToQore(QPC_DATE);
         return getQoreDateTimeFromDelta(val);
     }
 
     if (type == &PyDict_Type) {
+        incConvToQore(QPC_HASH);
         return getQoreHashFromDict(xsink, val, rset);
     }
 
     if (PyFunction_Check(val)) {
+        incConvToQore(QPC_CALLABLE);
         return getQoreCallRefFromFunc(xsink, val);
     }
 
     if (PyMethod_Check(val)) {
+        incConvToQore(QPC_CALLABLE);
         return getQoreCallRefFromMethod(xsink, val);
     }
 
@@ -1553,6 +2249,8 @@ QoreValue QorePythonProgram::getQoreValue(ExceptionSink* xsink, PyObject* val, p
         return QoreValue();
     }
 
+    incConvToQore(QPC_OBJECT);
+    incStat(QPS_WRAPPERS_CREATED);
     Py_INCREF(val);
     QoreObject* obj = new QoreObject(cls, qpgm, new QorePythonPrivateData(val));
     //printd(5, "QorePythonProgram::getQoreValue() obj: %p cls: %p '%s' id: %d\n", obj, cls, cls->getName(),
@@ -1621,14 +2319,22 @@ PyObject* QorePythonProgram::getPythonTupleValue(ExceptionSink* xsink, const Qor
 }
 
 PyObject* QorePythonProgram::getPythonDict(ExceptionSink* xsink, const QoreHashNode* h) {
+#if PY_VERSION_HEX < 0x030D0000
+    QorePythonReferenceHolder dict(_PyDict_NewPresized(h->size()));
+#else
     QorePythonReferenceHolder dict(PyDict_New());
+#endif
     ConstHashIterator i(h);
     while (i.next()) {
-        QorePythonReferenceHolder key(getPythonString(xsink, i.getKeyString()));
+        // interned keys are reused for all hashes with the same keys, so their hashes are only calculated once
+        QorePythonReferenceHolder key(getPythonKey(xsink, i.getKey()));
         if (*xsink) {
             raisePythonException(*xsink);
             return nullptr;
         }
+        if (!key) {
+            return nullptr;
+        }
         QorePythonReferenceHolder val(getPythonValue(i.get(), xsink));
         if (*xsink) {
             raisePythonException(*xsink);
@@ -1650,6 +2356,28 @@ PyObject* QorePythonProgram::getPythonString(ExceptionSink* xsink, const QoreStr
     return PyUnicode_FromStringAndSize(py_str->c_str(), py_str->size());
 }
 
+PyObject* QorePythonProgram::getPythonStringCached(ExceptionSink* xsink, const QoreString* str) {
+    TempEncodingHelper py_str(str, QCS_UTF8, xsink);
+    if (*xsink) {
+        raisePythonException(*xsink);
+        return nullptr;
+    }
+    return str_cache.getPythonString(py_str->c_str(), py_str->size());
+}
+
+PyObject* QorePythonProgram::getPythonKey(ExceptionSink* xsink, const char* key) {
+    size_t len = strlen(key);
+    if (QCS_DEFAULT != QCS_UTF8) {
+        QoreString str(key, len, QCS_DEFAULT);
+        return len <= QorePythonStringCache::MAX_KEY_LEN
+            ? getPythonStringCached(xsink, &str)
+            : getPythonString(xsink, &str);
+    }
+    return len <= QorePythonStringCache::MAX_KEY_LEN
+        ? str_cache.getPythonString(key, len)
+        : PyUnicode_FromStringAndSize(key, len);
+}
+
 PyObject* QorePythonProgram::getPythonByteArray(ExceptionSink* xsink, const BinaryNode* b) {
     return PyByteArray_FromStringAndSize(reinterpret_cast<const char*>(b->getPtr()), b->size());
 }
@@ -1665,8 +2393,12 @@ PyObject* QorePythonProgram::getPythonDelta(ExceptionSink* xsink, const DateTime
 PyObject* QorePythonProgram::getPythonDateTime(ExceptionSink* xsink, const DateTime* dt) {
     assert(dt->isAbsolute());
 
-    return PyDateTime_FromDateAndTime(dt->getYear(), dt->getMonth(), dt->getDay(), dt->getHour(), dt->getMinute(),
-        dt->getSecond(), dt->getMicrosecond());
+    PyObject* tz = getPythonTimezone(dt->getUTCOffset());
+    if (!tz) {
+        return nullptr;
+    }
+    return PyDateTimeAPI->DateTime_FromDateAndTime(dt->getYear(), dt->getMonth(), dt->getDay(), dt->getHour(),
+        dt->getMinute(), dt->getSecond(), dt->getMicrosecond(), tz, PyDateTimeAPI->DateTimeType);
 }
 
 PyObject* QorePythonProgram::getPythonCallable(ExceptionSink* xsink, const ResolvedCallReferenceNode* call) {
@@ -1679,34 +2411,51 @@ PyObject* QorePythonProgram::getPythonValue(QoreValue val, ExceptionSink* xsink)
     switch (val.getType()) {
         case NT_NOTHING:
         case NT_NULL:
+            incConvToPython(QPC_NONE);
             Py_INCREF(Py_None);
             return Py_None;
 
         case NT_BOOLEAN: {
+            incConvToPython(QPC_BOOL);
             PyObject* rv = val.getAsBool() ? Py_True : Py_False;
             Py_INCREF(rv);
             return rv;
         }
 
         case NT_INT:
+            incConvToPython(QPC_INT);
             return PyLong_FromLongLong(val.getAsBigInt());
 
         case NT_FLOAT:
+            incConvToPython(QPC_FLOAT);
             return PyFloat_FromDouble(val.getAsFloat());
 
-        case NT_STRING:
-            return getPythonString(xsink, val.get<const QoreStringNode>());
+        case NT_STRING: {
+            const QoreStringNode* str = val.get<const QoreStringNode>();
+            incConvToPython(QPC_STRING);
+            incStat(QPS_BYTES_TO_PYTHON, str->size());
+            return str->size() <= QorePythonStringCache::MAX_VALUE_LEN
+                ? getPythonStringCached(xsink, str)
+                : getPythonString(xsink, str);
+        }
 
         case NT_LIST:
+            incConvToPython(QPC_LIST);
             return getPythonList(xsink, val.get<const QoreListNode>());
 
         case NT_HASH:
+            incConvToPython(QPC_HASH);
             return getPythonDict(xsink, val.get<const QoreHashNode>());
 
-        case NT_BINARY:
-            return getPythonByteArray(xsink, val.get<const BinaryNode>());
+        case NT_BINARY: {
+            const BinaryNode* b = val.get<const BinaryNode>();
+            incConvToPython(QPC_BINARY);
+            incStat(QPS_BYTES_TO_PYTHON, b->size());
+            return getPythonByteArray(xsink, b);
+        }
 
         case NT_DATE: {
+            incConvToPython(QPC_DATE);
             const DateTimeNode* dt = val.get<const DateTimeNode>();
             return dt->isRelative()
                 ? getPythonDelta(xsink, dt)
@@ -1715,10 +2464,12 @@ PyObject* QorePythonProgram::getPythonValue(QoreValue val, ExceptionSink* xsink)
 
         case NT_RUNTIME_CLOSURE:
         case NT_FUNCREF: {
+            incConvToPython(QPC_CALLABLE);
             return getPythonCallable(xsink, val.get<const ResolvedCallReferenceNode>());
         }
 
         case NT_OBJECT: {
+            incConvToPython(QPC_OBJECT);
             QoreObject* o = const_cast<QoreObject*>(val.get<const QoreObject>());
             if (!o->isValid()) {
                 Py_INCREF(Py_None);
@@ -1733,11 +2484,13 @@ PyObject* QorePythonProgram::getPythonValue(QoreValue val, ExceptionSink* xsink)
             }
 
             PythonQoreClass* py_cls = findCreatePythonClass(*o->getClass(), "qore");
+            incStat(QPS_WRAPPERS_CREATED);
             return py_cls->wrap(o);
         }
     }
 
     // ignore types that cannot be converted to a Python value and return None
+    incConvToPython(QPC_NONE);
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -1757,6 +2510,7 @@ QoreValue QorePythonProgram::callFunction(ExceptionSink* xsink, const QoreString
         return QoreValue();
     }
 
+    QorePythonGilSiteHelper gsh(nullptr, fname->c_str());
     ValueHolder rv(xsink);
     {
         QorePythonHelper qph(this);
@@ -1804,6 +2558,7 @@ QoreValue QorePythonProgram::callMethod(ExceptionSink* xsink, const char* cname,
         return QoreValue();
     }
 
+    QorePythonGilSiteHelper gsh(cname, mname);
     QorePythonHelper qph(this);
     if (checkValid(xsink)) {
         return QoreValue();
@@ -1850,21 +2605,30 @@ QoreValue QorePythonProgram::callInternal(ExceptionSink* xsink, PyObject* callab
     }
     //printd(5, "QorePythonProgram::callInternal() f: %p args: %d (%d) self: %p\n", callable,
     //  args ? (int)args->size() : 0, (int)arg_offset, first);
+    QorePythonProfileHelper proh(profiler, callable);
     QorePythonReferenceHolder rv(callPythonInternal(xsink, callable, args, arg_offset, first));
-    return *xsink ? QoreValue() : getQoreValue(xsink, rv.release());
+    if (*xsink) {
+        return QoreValue();
+    }
+    QorePythonProfileConvHelper pcvh;
+    return getQoreValue(xsink, rv.release());
 }
 
 PyObject* QorePythonProgram::callPythonInternal(ExceptionSink* xsink, PyObject* callable, const QoreListNode* args,
     size_t arg_offset, PyObject* first, PyObject* kwargs) {
     QorePythonReferenceHolder py_args;
 
-    py_args = getPythonTupleValue(xsink, args, arg_offset, first);
+    {
+        QorePythonProfileConvHelper pcvh;
+        py_args = getPythonTupleValue(xsink, args, arg_offset, first);
+    }
     if (*xsink) {
         return nullptr;
     }
 
     printd(5, "QorePythonProgram::callPythonInternal(): this: %p valid: %d argcount: %d (first: %p)\n", this, valid,
       (args && args->size() > arg_offset) ? args->size() - arg_offset : 0, first);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyEval_CallObjectWithKeywords(callable, *py_args, kwargs));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
@@ -1886,18 +2650,25 @@ QoreValue QorePythonProgram::callFunctionObject(ExceptionSink* xsink, PyObject*
     if (checkValid(xsink)) {
         return QoreValue();
     }
-    QorePythonReferenceHolder py_args(getPythonTupleValue(xsink, args, arg_offset, first));
+    QorePythonProfileHelper proh(profiler, func);
+    QorePythonReferenceHolder py_args;
+    {
+        QorePythonProfileConvHelper pcvh;
+        py_args = getPythonTupleValue(xsink, args, arg_offset, first);
+    }
     if (*xsink) {
         return QoreValue();
     }
 
     //printd(5, "QorePythonProgram::callFunctionObject(): this: %p valid: %d argcount: %d\n", this, valid,
     //  (args && args->size() > arg_offset) ? args->size() - arg_offset : 0);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyFunction_Type.tp_call(func, *py_args, nullptr));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
         return QoreValue();
     }
+    QorePythonProfileConvHelper pcvh;
     return getQoreValue(xsink, return_value.release());
 }
 
@@ -1914,6 +2685,8 @@ int QorePythonProgram::checkPythonException(ExceptionSink* xsink) {
         return 0;
     }
 
+    incStat(QPS_EXCEPTIONS_TO_QORE);
+
     QorePythonReferenceHolder ex_type, ex_value, traceback;
     PyErr_Fetch(ex_type.getRef(), ex_value.getRef(), traceback.getRef());
     assert(ex_type);
@@ -2085,7 +2858,6 @@ int QorePythonProgram::checkPythonException(ExceptionSink* xsink) {
 QoreValue QorePythonProgram::callPythonMethod(ExceptionSink* xsink, PyObject* attr, PyObject* obj,
     const QoreListNode* args, size_t arg_offset) {
     PyTypeObject* mtype = Py_TYPE(attr);
-    printf("callPythonMethod() '%s' '%s'\n", mtype->tp_name, Py_TYPE(obj)->tp_name);
     // check for static method
     if (mtype == &PyStaticMethod_Type) {
         // get callable from static method
@@ -2191,6 +2963,16 @@ QoreClass* QorePythonProgram::getCreateQorePythonClassIntern(ExceptionSink* xsin
 
     clmap_t::iterator i = clmap.lower_bound(type);
     if (i != clmap.end() && i->first == type) {
+        // complete a class created with members resolved on demand if all members are requested
+        if ((flags & PCF_FULL_WALK) && !i->second->isFull()) {
+            QorePythonClass* cls = i->second;
+            if (type->tp_base && !getCreateQorePythonClassIntern(xsink, type->tp_base, nsset, nullptr, flags)) {
+                assert(*xsink);
+                return nullptr;
+            }
+            addTypeDictMembers(cls, type, false, true);
+            cls->setFull();
+        }
         return i->second;
     }
 
@@ -2257,6 +3039,22 @@ QorePythonClass* QorePythonProgram::addClassToNamespaceIntern(ExceptionSink* xsi
     return setupQorePythonClass(xsink, ns, type, cls, nsset, flags);
 }
 
+bool QorePythonProgram::hasQoreBaseClass(PyTypeObject* type) {
+    PyObject* mro = type->tp_mro;
+    if (!mro || !PyTuple_Check(mro)) {
+        return false;
+    }
+    Py_ssize_t len = PyTuple_Size(mro);
+    for (Py_ssize_t i = 1; i < len; ++i) {
+        // returns a borrowed reference
+        PyObject* base = PyTuple_GetItem(mro, i);
+        if (PyType_Check(base) && PyQoreObjectType_Check(reinterpret_cast<PyTypeObject*>(base))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static constexpr int static_meth_flags = QCF_USES_EXTRA_ARGS;
 static constexpr int normal_meth_flags = static_meth_flags | QCF_ABSTRACT_OVERRIDE_ALL;
 
@@ -2275,7 +3073,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
 
     // add single base class
     if (type->tp_base) {
-        QoreClass* bclass = getCreateQorePythonClassIntern(xsink, type->tp_base, nsset);
+        QoreClass* bclass = getCreateQorePythonClassIntern(xsink, type->tp_base, nsset, nullptr, flags);
         if (!bclass) {
             assert(*xsink);
             return nullptr;
@@ -2293,6 +3091,18 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
     printd(5, "QorePythonProgram::setupQorePythonClass() %s methods: %p\n", type->tp_name,
         type->tp_methods);
 
+    // normal methods and members are resolved on demand by methodGate() and memberGate() unless all methods are
+    // requested or the class may have to implement abstract methods inherited from a Qore class
+    bool full = (flags & PCF_FULL_WALK) || hasQoreBaseClass(type);
+    addTypeDictMembers(cls.get(), type, true, full);
+    if (full) {
+        cls->setFull();
+    }
+
+    return cls.release();
+}
+
+void QorePythonProgram::addTypeDictMembers(QorePythonClass* cls, PyTypeObject* type, bool eager, bool lazy) {
     // process dict
     if (type->tp_dict) {
         PyObject* key, * value;
@@ -2300,9 +3110,13 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
 
         while (PyDict_Next(type->tp_dict, &pos, &key, &value)) {
             assert(Py_TYPE(key) == &PyUnicode_Type);
-            const char* keystr = PyUnicode_AsUTF8(key);
-
             PyTypeObject* var_type = Py_TYPE(value);
+            // static methods cannot be resolved with a gate method
+            if (!((var_type == &PyStaticMethod_Type || PyCFunction_Check(value)) ? eager : lazy)) {
+                continue;
+            }
+
+            const char* keystr = PyUnicode_AsUTF8(key);
             // check for static method
             if (var_type == &PyStaticMethod_Type) {
                 // get callable from static method
@@ -2313,7 +3127,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addStaticMethod((void*)py_method, keystr,
                     (q_external_static_method_t)QorePythonProgram::execPythonStaticMethod, Public, static_meth_flags,
                     QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added static method " \
+                printd(5, "QorePythonProgram::addTypeDictMembers() added static method " \
                     "%s.%s() (%s)\n", type->tp_name, keystr, Py_TYPE(value)->tp_name);
                 continue;
             }
@@ -2327,7 +3141,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addMethod((void*)value, keystr,
                     (q_external_method_t)QorePythonProgram::execPythonNormalWrapperDescriptorMethod, Public,
                     normal_meth_flags, QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added normal wrapper " \
+                printd(5, "QorePythonProgram::addTypeDictMembers() added normal wrapper " \
                     "descriptor method %s.%s() (%s) %p: %d\n", type->tp_name, keystr, Py_TYPE(value)->tp_name, value,
                     value->ob_refcnt);
                 continue;
@@ -2342,7 +3156,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addMethod((void*)value, keystr,
                     (q_external_method_t)QorePythonProgram::execPythonNormalMethodDescriptorMethod, Public,
                     normal_meth_flags, QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added normal method " \
+                printd(5, "QorePythonProgram::addTypeDictMembers() added normal method " \
                     "descriptor method %s.%s() (%s) %p: %d\n", type->tp_name, keystr, Py_TYPE(value)->tp_name, value,
                     value->ob_refcnt);
                 continue;
@@ -2356,7 +3170,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addMethod((void*)value, keystr,
                     (q_external_method_t)QorePythonProgram::execPythonNormalClassMethodDescriptorMethod, Public,
                     normal_meth_flags, QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added normal "
+                printd(5, "QorePythonProgram::addTypeDictMembers() added normal "
                     "classmethod descriptor method %s.%s() (%s)\n", type->tp_name, keystr, Py_TYPE(value)->tp_name);
                 continue;
             }
@@ -2370,7 +3184,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addMethod((void*)value, keystr,
                     (q_external_method_t)QorePythonProgram::execPythonNormalMethod, Public, normal_meth_flags,
                     QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added normal method " \
+                printd(5, "QorePythonProgram::addTypeDictMembers() added normal method " \
                     "%s.%s() (%s)\n", type->tp_name, keystr, Py_TYPE(value)->tp_name);
                 continue;
             }
@@ -2380,7 +3194,7 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 cls->addStaticMethod((void*)value, keystr,
                     (q_external_static_method_t)QorePythonProgram::execPythonStaticCFunctionMethod, Public,
                     static_meth_flags, QDOM_UNCONTROLLED_API, autoTypeInfo);
-                printd(5, "QorePythonProgram::setupQorePythonClass() added static C function method " \
+                printd(5, "QorePythonProgram::addTypeDictMembers() added static C function method " \
                     "%s.%s() (%s)\n", type->tp_name, keystr, Py_TYPE(value)->tp_name);
                 continue;
             }
@@ -2390,17 +3204,16 @@ QorePythonClass* QorePythonProgram::setupQorePythonClass(ExceptionSink* xsink, Q
                 continue;
             }
 
-            printd(5, "QorePythonProgram::setupQorePythonClass() %s: member '%s': %s\n", type->tp_name, keystr,
+            printd(5, "QorePythonProgram::addTypeDictMembers() %s: member '%s': %s\n", type->tp_name, keystr,
                 Py_TYPE(value)->tp_name);
         }
     }
-
-    return cls.release();
 }
 
 QoreValue QorePythonProgram::execPythonStaticCFunctionMethod(const QoreMethod& meth, PyObject* func,
     const QoreListNode* args, q_rt_flags_t rtflags, ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callCFunctionMethod(xsink, func, args);
 }
 
@@ -2410,6 +3223,12 @@ QoreValue QorePythonProgram::execPythonCFunction(PyObject* func, const QoreListN
     return pypgm->callCFunctionMethod(xsink, func, args);
 }
 
+QoreValue QorePythonProgram::execPythonBuiltinFunction(const char* name, const QoreListNode* args,
+        q_rt_flags_t rtflags, ExceptionSink* xsink) {
+    QorePythonProgram* pypgm = QorePythonProgram::getContext();
+    return pypgm->callBuiltinFunction(xsink, name, args);
+}
+
 QoreValue QorePythonProgram::execPythonFunction(PyObject* func, const QoreListNode* args, q_rt_flags_t rtflags,
         ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getContext();
@@ -2437,6 +3256,7 @@ QoreValue QorePythonProgram::callCFunctionMethod(ExceptionSink* xsink, PyObject*
 
     //printd(5, "QorePythonProgram::callCMethod(): calling '%s' argcount: %d\n", fname->c_str(),
     //  (args && args->size() > arg_offset) ? args->size() - arg_offset : 0);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyCFunction_Call(func, *py_args, nullptr));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
@@ -2446,6 +3266,24 @@ QoreValue QorePythonProgram::callCFunctionMethod(ExceptionSink* xsink, PyObject*
     return getQoreValue(xsink, *return_value);
 }
 
+QoreValue QorePythonProgram::callBuiltinFunction(ExceptionSink* xsink, const char* name, const QoreListNode* args) {
+    QorePythonHelper qph(this);
+    if (checkValid(xsink)) {
+        return QoreValue();
+    }
+
+    // builtin functions are resolved in the current interpreter, as the function table is shared
+    // returns a borrowed reference
+    PyObject* func = PyDict_GetItemString(PyEval_GetBuiltins(), name);
+    if (!func || !PyCFunction_Check(func)) {
+        xsink->raiseException("PYTHON-ERROR", "builtin function '%s' is not available", name);
+        return QoreValue();
+    }
+    QorePythonReferenceHolder func_holder(func);
+    func_holder.py_ref();
+    return callCFunctionMethod(xsink, func, args);
+}
+
 void QorePythonProgram::execPythonConstructor(const QoreMethod& meth, PyObject* pycls, QoreObject* self,
     const QoreListNode* args, q_rt_flags_t rtflags, ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
@@ -2455,6 +3293,7 @@ void QorePythonProgram::execPythonConstructor(const QoreMethod& meth, PyObject*
         return;
     }
 
+    QorePythonGilSiteHelper gsh(meth.getClassName(), "constructor");
     QorePythonHelper qph(pypgm);
     if (pypgm->checkValid(xsink)) {
         return;
@@ -2464,6 +3303,7 @@ void QorePythonProgram::execPythonConstructor(const QoreMethod& meth, PyObject*
 
     // save Qore object for any Python class that needs it
     QorePythonImplicitQoreArgHelper qpiqoh(self);
+    QorePythonProfileHelper proh(pypgm->profiler, pycls);
     QorePythonReferenceHolder pyobj(pypgm->callPythonInternal(xsink, pycls, args));
     if (*xsink) {
         return;
@@ -2490,12 +3330,14 @@ void QorePythonProgram::execPythonDestructor(const QorePythonClass& thisclass, P
 QoreValue QorePythonProgram::execPythonStaticMethod(const QoreMethod& meth, PyObject* m,
     const QoreListNode* args, q_rt_flags_t rtflags, ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callInternal(xsink, m, args);
 }
 
 QoreValue QorePythonProgram::execPythonNormalMethod(const QoreMethod& meth, PyObject* m, QoreObject* self,
     QorePythonPrivateData* pd, const QoreListNode* args, q_rt_flags_t rtflags, ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callInternal(xsink, m, args, 0, pd->get());
 }
 
@@ -2506,6 +3348,7 @@ QoreValue QorePythonProgram::execPythonNormalWrapperDescriptorMethod(const QoreM
     //  meth.getClassName(), meth.getName(), m, m->ob_refcnt);
     assert(m->ob_refcnt > 0);
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callWrapperDescriptorMethod(xsink, pd->get(), m, args);
 }
 
@@ -2515,6 +3358,7 @@ QoreValue QorePythonProgram::execPythonNormalMethodDescriptorMethod(const QoreMe
     //printd(5, "QorePythonProgram::execPythonNormalMethodDescriptorMethod() %s::%s() pyobj: %p: %d\n",
     //  meth.getClassName(), meth.getName(), m, m->ob_refcnt);
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callMethodDescriptorMethod(xsink, pd->get(), m, args);
 }
 
@@ -2522,6 +3366,7 @@ QoreValue QorePythonProgram::execPythonNormalClassMethodDescriptorMethod(const Q
     QoreObject* self, QorePythonPrivateData* pd, const QoreListNode* args, q_rt_flags_t rtflags,
     ExceptionSink* xsink) {
     QorePythonProgram* pypgm = QorePythonProgram::getPythonProgramFromMethod(meth, xsink);
+    QorePythonGilSiteHelper gsh(meth.getClassName(), meth.getName());
     return pypgm->callClassMethodDescriptorMethod(xsink, pd->get(), m, args);
 }
 
@@ -2539,6 +3384,7 @@ QoreValue QorePythonProgram::callWrapperDescriptorMethod(ExceptionSink* xsink, P
 
     //printd(5, "QorePythonProgram::callWrapperDescriptorMethod(): calling '%s' argcount: %d\n", fname->c_str(),
     //  (args && args->size() > arg_offset) ? args->size() - arg_offset : 0);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyWrapperDescr_Type.tp_call(obj, *py_args, nullptr));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
@@ -2563,6 +3409,7 @@ QoreValue QorePythonProgram::callMethodDescriptorMethod(ExceptionSink* xsink, Py
 
     //printd(5, "QorePythonProgram::callMethodDescriptorMethod(): calling '%s' argcount: %d\n", fname->c_str(),
     //  (args && args->size() > arg_offset) ? args->size() - arg_offset : 0);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyMethodDescr_Type.tp_call(obj, *py_args, nullptr));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
@@ -2590,6 +3437,7 @@ QoreValue QorePythonProgram::callClassMethodDescriptorMethod(ExceptionSink* xsin
 
     //printd(5, "QorePythonProgram::callClassMethodDescriptorMethod(): calling '%s' argcount: %d\n", fname->c_str(),
     //  (args && args->size() > arg_offset) ? args->size() - arg_offset : 0);
+    incStat(QPS_QORE_TO_PYTHON_CALLS);
     QorePythonReferenceHolder return_value(PyClassMethodDescr_Type.tp_call(obj, *py_args, nullptr));
     // check for Python exceptions
     if (!return_value && checkPythonException(xsink)) {
@@ -2599,6 +3447,42 @@ QoreValue QorePythonProgram::callClassMethodDescriptorMethod(ExceptionSink* xsin
     return getQoreValue(xsink, *return_value);
 }
 
+void QorePythonProgram::checkImportCaches() {
+    unsigned gen = import_cache_gen.load(std::memory_order_relaxed);
+    if (gen == import_cache_gen_seen) {
+        return;
+    }
+    import_cache_gen_seen = gen;
+    missing_mod_set.clear();
+    missing_ns_attr_set.clear();
+    if (*spec_cache) {
+        PyDict_Clear(*spec_cache);
+    }
+}
+
+PyObject* QorePythonProgram::getCachedModuleSpec(const char* name) {
+    checkImportCaches();
+    if (!spec_cache) {
+        return nullptr;
+    }
+    // returns a borrowed reference
+    return PyDict_GetItemString(*spec_cache, name);
+}
+
+void QorePythonProgram::cacheModuleSpec(const char* name, PyObject* spec) {
+    checkImportCaches();
+    if (!spec_cache) {
+        spec_cache = PyDict_New();
+        if (!spec_cache) {
+            PyErr_Clear();
+            return;
+        }
+    }
+    if (PyDict_SetItemString(*spec_cache, name, spec)) {
+        PyErr_Clear();
+    }
+}
+
 int QorePythonProgram::saveModule(const char* name, PyObject* mod) {
     QorePythonReferenceHolder sys(PyImport_ImportModule("sys"));
     if (!sys) {
@@ -2652,7 +3536,7 @@ int QorePythonProgram::import(ExceptionSink* xsink, const char* module, const ch
             // https://docs.python.org/3/reference/import.html:
             // any module that contains a __path__ attribute is considered a package
             return checkImportSymbol(xsink, mod_name.c_str(), *mod, PyObject_HasAttrString(*mod, "__path__"), symbol,
-                IF_ALL, false);
+                IF_ALL | IF_FULL_CLASS, false);
         }
     }
 
@@ -2673,9 +3557,18 @@ int QorePythonProgram::import(ExceptionSink* xsink, const char* module, const ch
     return importModule(xsink, *mod, module, IF_ALL);
 }
 
+//! returns the given __all__ value if it restricts the symbols imported, otherwise nullptr
+/** only tuples restrict the symbols imported; all public symbols of modules with an __all__ list are imported, as
+    existing code depends on this behavior
+*/
+static PyObject* get_module_all(PyObject* all) {
+    return all && PyTuple_Check(all) ? all : nullptr;
+}
+
 int QorePythonProgram::importModule(ExceptionSink* xsink, PyObject* mod, const char* module,
     int filter) {
     PythonModuleContextHelper mch(this, module);
+    filter &= ~IF_LAZY_CLASS;
 
     // if the module has already been imported, then ignore
     if (mod_set.find(mod) != mod_set.end()) {
@@ -2683,7 +3576,8 @@ int QorePythonProgram::importModule(ExceptionSink* xsink, PyObject* mod, const c
     }
     mod_set.insert(mod);
 
-    PyObject* main = PyImport_AddModule("__main__");
+    // programs in a shared interpreter add modules to their private module, as __main__ is shared
+    PyObject* main = (!interp_name.empty() && this->module) ? *this->module : PyImport_AddModule("__main__");
     assert(main);
     Py_INCREF(mod);
     if (PyModule_AddObject(main, module, mod) < 0) {
@@ -2704,14 +3598,20 @@ int QorePythonProgram::importModule(ExceptionSink* xsink, PyObject* mod, const c
     // any module that contains a __path__ attribute is considered a package
     bool is_package = (bool)PyDict_GetItemString(mod_dict, "__path__");
 
+    // create classes only when referenced
+    int sym_filter = filter;
+    if ((filter & IF_CLASS) && setLazyClassHandler(module)) {
+        sym_filter |= IF_LAZY_CLASS;
+    }
+
     //printd(5, "QorePythonProgram::importModule() '%s' mod: %p (%d) pkg: %d (def: %p)\n", module, mod, filter,
     //  is_package, PyModule_GetDef(mod));
 
     // check the dictionary for __all__, giving a list of strings as public symbols
     // returns a borrowed reference
     {
-        PyObject* all = PyDict_GetItemString(mod_dict, "__all__");
-        if (all && PyTuple_Check(all)) {
+        PyObject* all = get_module_all(PyDict_GetItemString(mod_dict, "__all__"));
+        if (all) {
             Py_ssize_t len = PyTuple_Size(all);
             for (Py_ssize_t i = 0; i < len; ++i) {
                 // returns a borrowed reference
@@ -2720,7 +3620,7 @@ int QorePythonProgram::importModule(ExceptionSink* xsink, PyObject* mod, const c
                     throw QoreStandardException("PYTHON-IMPORT-ERROR", "module '%s' __all__ has an invalid " \
                         "element with type '%s'; expecting 'str'", module, sv ? Py_TYPE(sv)->tp_name : "null");
                 }
-                if (checkImportSymbol(xsink, module, mod, is_package, PyUnicode_AsUTF8(sv), filter, true)) {
+                if (checkImportSymbol(xsink, module, mod, is_package, PyUnicode_AsUTF8(sv), sym_filter, true)) {
                     return -1;
                 }
             }
@@ -2741,7 +3641,7 @@ int QorePythonProgram::importModule(ExceptionSink* xsink, PyObject* mod, const c
                     "element with type '%s'; expecting 'str'", module, sv ? Py_TYPE(sv)->tp_name : "null");
             }
 
-            if (checkImportSymbol(xsink, module, mod, is_package, PyUnicode_AsUTF8(sv), filter, true)) {
+            if (checkImportSymbol(xsink, module, mod, is_package, PyUnicode_AsUTF8(sv), sym_filter, true)) {
                 return -1;
             }
         }
@@ -2767,7 +3667,7 @@ int QorePythonProgram::checkImportSymbol(ExceptionSink* xsink, const char* modul
 
     bool is_class = PyType_Check(*value);
     if (is_class) {
-        if (!(filter & IF_CLASS)) {
+        if (!(filter & IF_CLASS) || (filter & IF_LAZY_CLASS)) {
             return 0;
         }
     } else {
@@ -2784,6 +3684,186 @@ int QorePythonProgram::checkImportSymbol(ExceptionSink* xsink, const char* modul
     return importSymbol(xsink, *value, module, symbol, filter);
 }
 
+int QorePythonProgram::importBuiltins(ExceptionSink* xsink) {
+#if QORE_VERSION_CODE >= 10013
+    QorePythonReferenceHolder mod(PyImport_ImportModule("builtins"));
+    if (!mod) {
+        if (!checkPythonException(xsink)) {
+            xsink->raiseException("PYTHON-IMPORT-ERROR", "Python could not load module 'builtins'");
+        }
+        return -1;
+    }
+
+    // if the module has already been imported, then ignore
+    if (mod_set.find(*mod) != mod_set.end()) {
+        return 0;
+    }
+    mod_set.insert(*mod);
+
+    PyObject* main = PyImport_AddModule("__main__");
+    assert(main);
+    Py_INCREF(*mod);
+    if (PyModule_AddObject(main, "builtins", *mod) < 0) {
+        Py_DECREF(*mod);
+        if (!checkPythonException(xsink)) {
+            xsink->raiseException("PYTHON-IMPORT-ERROR", "module 'builtins' could not be added to the main module");
+        }
+        return -1;
+    }
+
+    if (!pyns->findLocalNamespace("builtins")) {
+        pyns->addNamespace(getBuiltinsNamespace(*mod)->copy());
+    }
+    // builtin classes are created on demand
+    setLazyClassHandler("builtins");
+    return 0;
+#else
+    return import(xsink, "builtins");
+#endif
+}
+
+const QoreNamespace* QorePythonProgram::getBuiltinsNamespace(PyObject* mod) {
+    AutoLocker al(builtins_lck);
+    if (builtins_ns) {
+        return builtins_ns;
+    }
+
+    builtins_ns = new QoreNamespace("builtins");
+    // returns a borrowed reference
+    PyObject* mod_dict = PyModule_GetDict(mod);
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(mod_dict, &pos, &key, &value)) {
+        if (!PyUnicode_Check(key)) {
+            continue;
+        }
+        const char* name = PyUnicode_AsUTF8(key);
+        if (PyCFunction_Check(value)) {
+            // the name is used to look up the function in the interpreter where it is called
+            strset_t::iterator i = builtins_name_set.insert(name).first;
+            builtins_ns->addBuiltinVariant((void*)i->c_str(), i->c_str(),
+                (q_external_func_t)QorePythonProgram::execPythonBuiltinFunction, QCF_USES_EXTRA_ARGS,
+                QDOM_UNCONTROLLED_API, autoTypeInfo);
+        } else if (PyBool_Check(value)) {
+            builtins_ns->addConstant(name, value == Py_True, boolTypeInfo);
+        } else if (PyUnicode_Check(value)) {
+            builtins_ns->addConstant(name, new QoreStringNode(PyUnicode_AsUTF8(value), QCS_UTF8), stringTypeInfo);
+        }
+        // classes are created on demand, and other objects are specific to each interpreter; None has no
+        // constant, as it converts to NOTHING, which was never imported as a constant
+    }
+    printd(5, "QorePythonProgram::getBuiltinsNamespace() created shared builtins namespace with %d function(s)\n",
+        (int)builtins_name_set.size());
+    return builtins_ns;
+}
+
+const QoreNamespace* QorePythonProgram::getBuiltinsNamespace() {
+    {
+        AutoLocker al(builtins_lck);
+        if (builtins_ns) {
+            return builtins_ns;
+        }
+    }
+
+    QorePythonGilHelper qpgh;
+    QorePythonReferenceHolder mod(PyImport_ImportModule("builtins"));
+    if (!mod) {
+        PyErr_Clear();
+        return nullptr;
+    }
+    return getBuiltinsNamespace(*mod);
+}
+
+void QorePythonProgram::staticCleanup() {
+    AutoLocker al(builtins_lck);
+    delete builtins_ns;
+    builtins_ns = nullptr;
+    builtins_name_set.clear();
+}
+
+bool QorePythonProgram::setLazyClassHandler(const char* module) {
+#if QORE_VERSION_CODE >= 10013
+    QoreString ns_path(module);
+    ns_path.replaceAll(".", "::");
+    QoreNamespace* ns = pyns->findCreateNamespacePathAll(ns_path.c_str());
+    ns->setKeyValueIfNotSet("python_module", module);
+    ns->setClassHandler(lazyClassHandler);
+    return true;
+#else
+    return false;
+#endif
+}
+
+QoreClass* QorePythonProgram::lazyClassHandler(QoreNamespace* ns, const char* cname) {
+#if QORE_VERSION_CODE >= 10013
+    ValueHolder mod_name(ns->getReferencedKeyValue("python_module"), nullptr);
+    if (!mod_name || mod_name->getType() != NT_STRING) {
+        return nullptr;
+    }
+    // grab current Program's parse lock before manipulating namespaces
+    CurrentProgramRuntimeExternalParseContextHelper pch;
+    if (!pch) {
+        return nullptr;
+    }
+    QorePythonProgram* pypgm = getExecutionContext();
+    if (!pypgm || !pypgm->valid) {
+        return nullptr;
+    }
+    const char* module = mod_name->get<const QoreStringNode>()->c_str();
+    //printd(5, "QorePythonProgram::lazyClassHandler() ns: '%s' module: '%s' class: '%s'\n", ns->getName(), module,
+    //  cname);
+
+    QorePythonHelper qph(pypgm);
+    QoreString py_mod_name(module);
+    py_mod_name.replaceAll("::", ".");
+    QorePythonReferenceHolder mod(PyImport_ImportModule(py_mod_name.c_str()));
+    if (!mod || !PyObject_HasAttrString(*mod, cname)) {
+        PyErr_Clear();
+        return nullptr;
+    }
+    QorePythonReferenceHolder value(PyObject_GetAttrString(*mod, cname));
+    if (!value || !PyType_Check(*value)) {
+        PyErr_Clear();
+        return nullptr;
+    }
+
+    // only create classes that would be imported eagerly
+    // returns a borrowed reference
+    PyObject* mod_dict = PyModule_Check(*mod) ? PyModule_GetDict(*mod) : nullptr;
+    PyObject* all = get_module_all(mod_dict ? PyDict_GetItemString(mod_dict, "__all__") : nullptr);
+    if (all) {
+        bool found = false;
+        Py_ssize_t len = PyTuple_Size(all);
+        for (Py_ssize_t i = 0; i < len; ++i) {
+            // returns a borrowed reference
+            PyObject* sv = PyTuple_GetItem(all, i);
+            if (sv && PyUnicode_Check(sv) && !strcmp(PyUnicode_AsUTF8(sv), cname)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return nullptr;
+        }
+    }
+
+    ExceptionSink xsink;
+    PythonModuleContextHelper mch(pypgm, module);
+    strset_t nsset;
+    QoreClass* cls = pypgm->getCreateQorePythonClassIntern(&xsink, reinterpret_cast<PyTypeObject*>(*value), nsset);
+    if (xsink) {
+        printd(5, "QorePythonProgram::lazyClassHandler() error creating class %s.%s\n", module, cname);
+        xsink.clear();
+        return nullptr;
+    }
+    // the class may have been created with a different name if it is an alias
+    return (cls && !strcmp(cls->getName(), cname)) ? cls : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
 int QorePythonProgram::findCreateQoreFunction(PyObject* value, const char* symbol, q_external_func_t func) {
     QoreNamespace* ns = getNamespaceForObject(value);
     if (!ns->findLocalFunction(symbol)) {
@@ -2816,7 +3896,8 @@ int QorePythonProgram::importSymbol(ExceptionSink* xsink, PyObject* value, const
         //printd(5, "QorePythonProgram::importSymbol() class sym: '%s' -> '%s' (%p)\n", symbol,
         //  reinterpret_cast<PyTypeObject*>(value)->tp_name, value);
         strset_t nsset;
-        getCreateQorePythonClassIntern(xsink, reinterpret_cast<PyTypeObject*>(value), nsset);
+        getCreateQorePythonClassIntern(xsink, reinterpret_cast<PyTypeObject*>(value), nsset, nullptr,
+            (filter & IF_FULL_CLASS) ? PCF_FULL_WALK : 0);
         if (*xsink) {
             return -1;
         }
@@ -2871,19 +3952,33 @@ PyObject* QorePythonProgram::callQoreFunction(PyObject* self, PyObject* args) {
     func_capsule_t* fc = reinterpret_cast<func_capsule_t*>(PyCapsule_GetPointer(self, nullptr));
     assert(&fc->func);
     assert(fc->py_pgm);
+    // the program that imported the function can be destroyed while the function remains in a shared interpreter;
+    // in this case values are converted by the calling program
+    QorePythonProgram* py_pgm = fc->py_pgm->valid ? fc->py_pgm : QorePythonProgram::getContext();
+
+    q_attach_thread_to_qore();
+    py_pgm->incStat(QPS_PYTHON_TO_QORE_CALLS);
+    QorePythonGilSiteHelper gsh(nullptr, fc->func.getName());
+
+    QorePythonProfileHelper proh(py_pgm->profiler, nullptr, fc->func.getName());
 
     // get Qore arguments
     ExceptionSink xsink;
     assert(PyTuple_Check(args));
-    ReferenceHolder<QoreListNode> qargs(fc->py_pgm->getQoreListFromTuple(&xsink, args), &xsink);
+    ReferenceHolder<QoreListNode> qargs(&xsink);
+    {
+        QorePythonProfileConvHelper pcvh;
+        qargs = py_pgm->getQoreListFromTuple(&xsink, args);
+    }
     if (!xsink) {
         ValueHolder rv(&xsink);
         {
             QorePythonReleaseGilHelper prgh;
-            rv = fc->func.evalFunction(nullptr, *qargs, fc->py_pgm->getQoreProgram(), &xsink);
+            rv = fc->func.evalFunction(nullptr, *qargs, fc->qpgm, &xsink);
         }
         if (!xsink) {
-            QorePythonReferenceHolder py_rv(fc->py_pgm->getPythonValue(*rv, &xsink));
+            QorePythonProfileConvHelper pcvh;
+            QorePythonReferenceHolder py_rv(py_pgm->getPythonValue(*rv, &xsink));
             if (!xsink) {
                 assert(py_rv);
                 return py_rv.release();
@@ -2891,7 +3986,7 @@ PyObject* QorePythonProgram::callQoreFunction(PyObject* self, PyObject* args) {
         }
     }
 
-    fc->py_pgm->raisePythonException(xsink);
+    py_pgm->raisePythonException(xsink);
     assert(PyErr_Occurred());
     return nullptr;
 }
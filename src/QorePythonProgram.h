@@ -37,12 +37,19 @@
 
 #include "QorePythonClass.h"
 #include "QorePythonPrivateData.h"
+#include "QorePythonStatistics.h"
+#include "QorePythonGilTelemetry.h"
+#include "QorePythonProfiler.h"
+#include "QorePythonCodeCache.h"
+#include "QorePythonArena.h"
+#include "QorePythonStringCache.h"
 
 #include <pythonrun.h>
 
 #include <set>
 #include <map>
 #include <memory>
+#include <vector>
 
 // forward reference
 class QorePythonProgram;
@@ -51,6 +58,13 @@ class PythonQoreClass;
 #define IF_CLASS (1 << 0)
 #define IF_OTHER (1 << 1)
 #define IF_ALL   (IF_CLASS | IF_OTHER)
+//! classes are created on demand by the namespace class handler
+#define IF_LAZY_CLASS (1 << 2)
+//! classes are created with all methods and members
+#define IF_FULL_CLASS (1 << 3)
+
+//! populate all methods and members when creating a Qore class for a Python type
+#define PCF_FULL_WALK (1 << 0)
 
 //! best guess at the ratio of stack size / x = python recursion limit to avoid crashes
 constexpr int PYTHON_LARGE_STACK_FACTOR = 10 * 1024;
@@ -70,6 +84,8 @@ public:
     DLLLOCAL QorePythonProgram();
 
     //! Default Qore Python context; does not own the QoreProgram reference
+    /** the Python interpreter is created when the context is first used
+    */
     DLLLOCAL QorePythonProgram(QoreProgram* qpgm, QoreNamespace* pyns);
 
     //! New Qore Python context; does not own the QoreProgram reference
@@ -81,8 +97,19 @@ public:
         }
     }
 
+    //! New Python program created from source
+    /** @param interp_name if not empty, the program is created in the shared interpreter with the given name, which
+        is created if necessary; otherwise a new interpreter is created for the program
+    */
     DLLLOCAL QorePythonProgram(const QoreString& source_code, const QoreString& source_label, int start,
-        ExceptionSink* xsink);
+        ExceptionSink* xsink, const char* interp_name = nullptr);
+
+    //! New Python program executing the given marshaled code object from a template program
+    /** @param interp_name if not empty, the name of the shared interpreter for the program; otherwise a new
+        interpreter is created for the program
+    */
+    DLLLOCAL QorePythonProgram(const std::shared_ptr<const std::string>& code, const std::string& source_label,
+        const std::string& interp_name, ExceptionSink* xsink);
 
     DLLLOCAL virtual AbstractQoreProgramExternalData* copy(QoreProgram* pgm) const {
         return new QorePythonProgram(*this, pgm);
@@ -107,6 +134,33 @@ public:
         deleteIntern(xsink);
     }
 
+    //! Returns the marshaled code object of a program created from source for cloning
+    /** the code is marshaled on the first call and shared by all clones
+
+        @return the marshaled code or an empty pointer if an exception was raised
+    */
+    DLLLOCAL std::shared_ptr<const std::string> getCloneCode(ExceptionSink* xsink);
+
+    //! Returns the source label of a program created from source
+    DLLLOCAL const std::string& getSourceLabel() const {
+        return source_label;
+    }
+
+    //! Returns the name of the shared interpreter or an empty string if the program has its own interpreter
+    DLLLOCAL const std::string& getInterpreterName() const {
+        return interp_name;
+    }
+
+    //! Returns a hash of shared interpreter names to the number of programs using each interpreter
+    DLLLOCAL static QoreHashNode* getSharedInterpreterInfo();
+
+    //! Keeps the Qore program alive as long as this program's shared interpreter exists
+    /** called when a Python module for Qore symbols is created; such modules are stored in the interpreter's
+        sys.modules and are therefore used by all programs sharing the interpreter, so the Qore program providing the
+        symbols must not be deleted before the interpreter; no-op if the program has its own interpreter
+    */
+    DLLLOCAL void pinQoreProgram();
+
     DLLLOCAL QoreValue run(ExceptionSink* xsink) {
         assert(python_code);
         QorePythonHelper qph(this);
@@ -125,8 +179,10 @@ public:
     }
 
     //! Evaluates the statement and returns any result
+    /** @param use_code_cache if true, the compiled code is stored in and retrieved from the code cache, if enabled
+    */
     DLLLOCAL QoreValue eval(ExceptionSink* xsink, const QoreString& source_code, const QoreString& source_label,
-            int input, bool encapsulate);
+            int input, bool encapsulate, bool use_code_cache = false);
 
     //! Call the function and return the result
     DLLLOCAL QoreValue callFunction(ExceptionSink* xsink, const QoreString& func_name, const QoreListNode* args,
@@ -212,9 +268,15 @@ public:
     */
     DLLLOCAL QoreHashNode* getQoreHashFromDict(ExceptionSink* xsink, PyObject* val);
 
-    //! Set Python thread context
+    //! Set Python thread context; creates the interpreter if necessary
     DLLLOCAL QorePythonThreadInfo setContext() const;
 
+    //! Creates the interpreter if it has not been created yet
+    DLLLOCAL int initInterpreter();
+
+    //! Creates the interpreter and initializes the main module
+    DLLLOCAL void initInterpreterIntern(QorePythonGilHelper& qpgh);
+
     //! Release Python thread context
     DLLLOCAL void releaseContext(const QorePythonThreadInfo& oldstate) const;
 
@@ -239,15 +301,14 @@ public:
         return qpgm;
     }
 
-    //! Saves a unique string
+    //! Saves a unique string; the string is valid for the lifetime of the program object
     DLLLOCAL const char* saveString(const char* str) {
-        std::string sstr = str;
-        strset_t::iterator i = strset.lower_bound(sstr);
-        if (i != strset.end() && *i == sstr) {
-            return (*i).c_str();
-        }
-        i = strset.insert(i, sstr);
-        return (*i).c_str();
+        return arena.saveString(str);
+    }
+
+    //! Returns the arena for metadata that must remain valid for the lifetime of the program object
+    DLLLOCAL QorePythonArena& getArena() {
+        return arena;
     }
 
     //! Saves Qore objects in thread-local data or using a callback
@@ -272,6 +333,14 @@ public:
     //! Imports a Qore class into a Python module
     DLLLOCAL int importQoreClassToPython(PyObject* mod, const QoreClass& cls, const char* mod_name);
 
+    //! Imports a single symbol from a Qore namespace into a Python module on demand
+    /** @return 0 = imported, 1 = not found, -1 = error (Python exception raised)
+    */
+    DLLLOCAL int importQoreSymbolToPython(PyObject* mod, QoreNamespace& ns, const char* name);
+
+    //! Returns a Python list of the names of all symbols in the given namespace without importing them
+    DLLLOCAL static PyObject* getQoreNamespaceSymbolList(const QoreNamespace& ns);
+
     //! Creates an alias for an existing definition
     DLLLOCAL void aliasDefinition(const QoreString& source_path, const QoreString& target_path);
 
@@ -301,6 +370,15 @@ public:
     DLLLOCAL QorePythonClass* setupQorePythonClass(ExceptionSink* xsink, QoreNamespace* ns, PyTypeObject* type,
             std::unique_ptr<QorePythonClass>& cls, strset_t& nsset, int flags = 0);
 
+    //! Adds methods and members from the type's dictionary to the class
+    /** @param eager add static methods and builtin functions, which cannot be resolved on demand
+        @param lazy add all other methods and members, which are otherwise resolved on demand by the gate methods
+    */
+    DLLLOCAL static void addTypeDictMembers(QorePythonClass* cls, PyTypeObject* type, bool eager, bool lazy);
+
+    //! Returns true if the given Python type inherits a Qore class
+    DLLLOCAL static bool hasQoreBaseClass(PyTypeObject* type);
+
     //! Creates ot retrieves a QoreClass for the given Python type
     DLLLOCAL QoreClass* getCreateQorePythonClass(ExceptionSink* xsink, PyTypeObject* type, int flags = 0);
 
@@ -332,7 +410,7 @@ public:
     DLLLOCAL static DateTimeNode* getQoreDateTimeFromDelta(PyObject* val);
 
     //! Returns a Qore absolute date time value from a Python DateTime object
-    DLLLOCAL static DateTimeNode* getQoreDateTimeFromDateTime(PyObject* val);
+    DLLLOCAL DateTimeNode* getQoreDateTimeFromDateTime(PyObject* val);
 
     //! Returns a Qore absolute date time value from a Python Date object
     DLLLOCAL static DateTimeNode* getQoreDateTimeFromDate(PyObject* val);
@@ -343,14 +421,20 @@ public:
     //! Returns a Python string for the given Qore string
     DLLLOCAL static PyObject* getPythonString(ExceptionSink* xsink, const QoreString* str);
 
+    //! Returns an interned Python string for the given short Qore string from the program's string cache
+    DLLLOCAL PyObject* getPythonStringCached(ExceptionSink* xsink, const QoreString* str);
+
+    //! Returns an interned Python string for the given Qore hash key from the program's string cache
+    DLLLOCAL PyObject* getPythonKey(ExceptionSink* xsink, const char* key);
+
     //! Returns a Python string for the given Qore string
     DLLLOCAL static PyObject* getPythonByteArray(ExceptionSink* xsink, const BinaryNode* b);
 
     //! Returns a Python delta for the given Qore relative date/time value
     DLLLOCAL static PyObject* getPythonDelta(ExceptionSink* xsink, const DateTime* dt);
 
-    //! Returns a Python string for the given Qore absolute date/time value
-    DLLLOCAL static PyObject* getPythonDateTime(ExceptionSink* xsink, const DateTime* dt);
+    //! Returns a timezone-aware Python datetime for the given Qore absolute date/time value
+    DLLLOCAL PyObject* getPythonDateTime(ExceptionSink* xsink, const DateTime* dt);
 
     //! Returns a Python callable object for the given Qore closure / call reference
     DLLLOCAL static PyObject* getPythonCallable(ExceptionSink* xsink, const ResolvedCallReferenceNode* call);
@@ -389,6 +473,9 @@ public:
     //! Static initialization
     DLLLOCAL static int staticInit();
 
+    //! Static cleanup
+    DLLLOCAL static void staticCleanup();
+
     //! Delete thread local data when a thread terminates
     DLLLOCAL static void pythonThreadCleanup(void*);
 
@@ -398,16 +485,172 @@ public:
     //! Does this thread hold the GIL with the given thread state?
     DLLLOCAL static bool haveGilUnlocked(PyThreadState* tstate);
 
+    //! Increments the given statistics counter for this program and globally if statistics are enabled
+    DLLLOCAL void incStat(qore_python_stat_e stat, uint64_t val = 1) const {
+        if (QorePythonStatistics::isEnabled()) {
+            addStat(stat, val);
+        }
+    }
+
+    //! Increments the given statistics counter for this program and globally
+    /** the caller must have checked QorePythonStatistics::isEnabled()
+    */
+    DLLLOCAL void addStat(qore_python_stat_e stat, uint64_t val = 1) const {
+        stats.inc(stat, val);
+        QorePythonStatistics::global.inc(stat, val);
+    }
+
+    //! Increments the conversion counter for the given type for conversions from Qore to Python if enabled
+    DLLLOCAL void incConvToPython(qore_python_conv_e type) const {
+        if (QorePythonStatistics::isEnabled()) {
+            stats.incToPython(type);
+            QorePythonStatistics::global.incToPython(type);
+        }
+    }
+
+    //! Increments the conversion counter for the given type for conversions from Python to Qore if enabled
+    DLLLOCAL void incConvToQore(qore_python_conv_e type) const {
+        if (QorePythonStatistics::isEnabled()) {
+            stats.incToQore(type);
+            QorePythonStatistics::global.incToQore(type);
+        }
+    }
+
+    //! Saves a shallow copy of the module dictionary to be restored by reset()
+    DLLLOCAL int snapshot(ExceptionSink* xsink);
+
+    //! Restores the module dictionary from the last snapshot and drops per-job state
+    /** drops objects saved for the current thread with the default object save mechanism and clears negative
+        import lookup caches; the interpreter, imported modules, and class mappings are retained
+
+        @param collect if true, a full garbage collection is run after the state has been restored
+    */
+    DLLLOCAL int reset(ExceptionSink* xsink, bool collect);
+
+    //! Returns bridge statistics for this program
+    DLLLOCAL QoreHashNode* getStatistics() const {
+        return stats.getHash();
+    }
+
+    //! Resets bridge statistics for this program
+    DLLLOCAL void resetStatistics() {
+        stats.reset();
+    }
+
+    //! Returns GIL telemetry histograms for this program
+    DLLLOCAL QorePythonGilStats& getGilStats() const {
+        return gil_stats;
+    }
+
+    //! Resets GIL telemetry histograms for this program
+    DLLLOCAL void resetGilStats() {
+        gil_stats.reset();
+    }
+
+    //! Returns the boundary profiler for this program
+    DLLLOCAL QorePythonProfiler& getProfiler() const {
+        return profiler;
+    }
+
+    //! Returns a cached module spec (borrowed reference) for the given module name or nullptr if not cached
+    DLLLOCAL PyObject* getCachedModuleSpec(const char* name);
+
+    //! Caches a module spec for the given module name
+    DLLLOCAL void cacheModuleSpec(const char* name, PyObject* spec);
+
+    //! Returns true if the given module name could not be found in a previous lookup
+    DLLLOCAL bool isMissingModule(const char* name) {
+        checkImportCaches();
+        return missing_mod_set.find(name) != missing_mod_set.end();
+    }
+
+    //! Records a module name that could not be found
+    DLLLOCAL void setMissingModule(const char* name) {
+        checkImportCaches();
+        missing_mod_set.insert(name);
+    }
+
+    //! Returns true if the given attribute could not be found in the namespace with the given path in a previous lookup
+    DLLLOCAL bool isMissingNsAttr(const std::string& ns_path, const char* name) {
+        checkImportCaches();
+        return missing_ns_attr_set.find(ns_attr_t(ns_path, name)) != missing_ns_attr_set.end();
+    }
+
+    //! Records an attribute that could not be found in the namespace with the given path
+    DLLLOCAL void setMissingNsAttr(const std::string& ns_path, const char* name) {
+        checkImportCaches();
+        missing_ns_attr_set.insert(ns_attr_t(ns_path, name));
+    }
+
+    //! Returns the cached root namespace for the given Qore module or nullptr if not cached
+    DLLLOCAL const QoreNamespace* getCachedModuleRootNs(const char* name) const {
+        mod_ns_map_t::const_iterator i = mod_root_ns_map.find(name);
+        return i == mod_root_ns_map.end() ? nullptr : i->second;
+    }
+
+    //! Caches the root namespace for the given Qore module
+    DLLLOCAL void cacheModuleRootNs(const char* name, const QoreNamespace* ns) {
+        mod_root_ns_map[name] = ns;
+    }
+
+    //! Adds the names of all cached module root namespaces to the given set
+    DLLLOCAL void getCachedModuleRootNsNames(strset_t& names) const {
+        for (auto& i : mod_root_ns_map) {
+            names.insert(i.second->getName());
+        }
+    }
+
+    //! Invalidates import lookup caches in all programs
+    /** called when Qore modules may have been loaded or a root namespace may have changed
+    */
+    DLLLOCAL static void invalidateImportCaches() {
+        import_cache_gen.fetch_add(1, std::memory_order_relaxed);
+    }
+
     //! Returns the program count
     DLLLOCAL static int getProgramCount() {
         AutoLocker al(py_thr_lck);
         return pgm_count;
     }
 
+    //! Runs a garbage collection if requested and freezes or unfreezes all tracked objects in all live interpreters
+    /** objects moved to the permanent generation are ignored by the garbage collector, so their memory pages are not
+        written to by collections in forked child processes
+
+        @param freeze if false, objects in the permanent generation are moved back to the oldest generation
+
+        @return a hash with the number of interpreters processed, objects collected, and objects frozen
+    */
+    DLLLOCAL static QoreHashNode* freezeInterpreters(ExceptionSink* xsink, bool collect, bool freeze = true);
+
+    //! Acquires the global thread lock before a fork; called with the GIL held
+    DLLLOCAL static void lockForFork() {
+        py_thr_lck.lock();
+    }
+
+    //! Releases the global thread lock in the parent after a fork
+    DLLLOCAL static void afterForkParent() {
+        py_thr_lck.unlock();
+    }
+
+    //! Resets the thread-state registry in the child after a fork and releases the global thread lock
+    /** @param tstate the thread state of the forking thread, which is the only thread state that survives in the
+        main interpreter
+    */
+    DLLLOCAL static void afterForkChild(PyThreadState* tstate);
+
 protected:
-    PyInterpreterState* interpreter;
+    PyInterpreterState* interpreter = nullptr;
     QorePythonReferenceHolder module;
     QorePythonReferenceHolder python_code;
+    //! the source label for programs created from source; also used as the module name
+    std::string source_label;
+    //! marshaled python_code shared with clones; created on demand with the GIL held
+    std::shared_ptr<const std::string> clone_code;
+    //! shallow copy of the module dictionary restored by reset()
+    QorePythonReferenceHolder state_snapshot;
+    //! the name of the shared interpreter, if any
+    std::string interp_name;
     PyObject* module_dict = nullptr;
     PyObject* builtin_dict = nullptr;
     //! each Python program object must have a corresponding Qore program object for Qore class generation
@@ -433,6 +676,14 @@ protected:
     //! if we should destroy the interpreter state
     bool owns_interpreter = false;
 
+    //! true if the interpreter has not been created yet
+    std::atomic<bool> needs_init{false};
+    //! the TID of the thread creating the interpreter, 0 if none; protected by init_lck
+    int init_tid = 0;
+    //! lock and condition for lazy interpreter creation; never held while acquiring the GIL
+    QoreThreadLock init_lck;
+    QoreCondition init_cond;
+
     //! maps types to classes
     typedef std::map<PyTypeObject*, QorePythonClass*> clmap_t;
     clmap_t clmap;
@@ -445,8 +696,60 @@ protected:
     typedef std::set<PyObject*> pyobj_set_t;
     pyobj_set_t mod_set;
 
-    //! set of unique strings
-    strset_t strset;
+    //! storage for unique strings and method definitions
+    QorePythonArena arena;
+
+    //! maps fixed-offset Python timezone objects to Qore zones; keys are strong references
+    typedef std::map<PyObject*, const AbstractQoreZoneInfo*> tz_zone_map_t;
+    tz_zone_map_t tz_zone_map;
+    //! maps UTC offsets in seconds east of UTC to Python timezone objects; values are strong references
+    typedef std::map<int, PyObject*> tz_obj_map_t;
+    tz_obj_map_t tz_obj_map;
+
+    //! interned strings for hash keys and short string values
+    QorePythonStringCache str_cache;
+
+    //! module specs for Qore modules found by the meta path finder; module name -> spec
+    QorePythonReferenceHolder spec_cache;
+    //! module names that the meta path finder could not find
+    strset_t missing_mod_set;
+    //! namespace attributes that could not be found; namespace path -> attribute name
+    typedef std::pair<std::string, std::string> ns_attr_t;
+    typedef std::set<ns_attr_t> ns_attr_set_t;
+    ns_attr_set_t missing_ns_attr_set;
+    //! map of Qore module names to root namespaces in the Qore program
+    typedef std::map<std::string, const QoreNamespace*> mod_ns_map_t;
+    mod_ns_map_t mod_root_ns_map;
+    //! the import cache generation that the caches are valid for
+    unsigned import_cache_gen_seen = 0;
+    //! global import cache generation; incremented when the caches are invalidated
+    DLLLOCAL static std::atomic<unsigned> import_cache_gen;
+
+    //! shared builtins namespace with functions and simple constants; copied into each program
+    DLLLOCAL static QoreNamespace* builtins_ns;
+    //! names of shared builtin functions; referenced by the functions in the shared namespace
+    DLLLOCAL static strset_t builtins_name_set;
+    //! lock for the shared builtins namespace
+    DLLLOCAL static QoreThreadLock builtins_lck;
+
+    //! a named interpreter shared by multiple programs
+    struct QorePythonSharedInterpreter {
+        PyInterpreterState* interp;
+        //! the number of programs using the interpreter
+        unsigned refs;
+        //! Qore programs providing modules in the interpreter; each holds a reference until the interpreter is deleted
+        std::set<QoreProgram*> pgm_set;
+        //! destroyed programs whose class wrappers and arenas are still referenced by modules in the interpreter
+        /** each holds a weak reference until the interpreter is deleted
+        */
+        std::vector<QorePythonProgram*> retained_vec;
+    };
+    //! map of shared interpreter names to interpreters; protected by py_thr_lck
+    typedef std::map<std::string, QorePythonSharedInterpreter> shared_interp_map_t;
+    DLLLOCAL static shared_interp_map_t shared_interp_map;
+
+    //! clears the import lookup caches if they have been invalidated
+    DLLLOCAL void checkImportCaches();
 
     //! mutex for thread state map
     static QoreThreadLock py_thr_lck;
@@ -474,15 +777,24 @@ protected:
     //! Map of Qore classes to Python classes
     py_cls_map_t py_cls_map;
 
-    typedef std::vector<PyMethodDef*> meth_vec_t;
-    meth_vec_t meth_vec;
-
     //! for weak refs
     QoreReferenceCounter weak_refs;
 
+    //! bridge statistics for this program
+    mutable QorePythonStatistics stats;
+
+    //! GIL telemetry for this program
+    mutable QorePythonGilStats gil_stats;
+
+    //! boundary profiler for this program
+    mutable QorePythonProfiler profiler;
+
     //! Saves Qore objects in thread-local data
     DLLLOCAL int saveQoreObjectFromPythonDefault(const QoreValue& rv, ExceptionSink& xsink);
 
+    //! Returns the thread-local data key for objects saved with saveQoreObjectFromPythonDefault()
+    DLLLOCAL static const char* getSaveDomain(const QoreHashNode* data);
+
     DLLLOCAL int importQoreNamespaceToPython(PyObject* mod, const QoreNamespace& ns);
 
     DLLLOCAL QoreNamespace* getNamespaceForObject(PyObject* type);
@@ -518,6 +830,25 @@ protected:
     //! Imports the given module
     DLLLOCAL int importModule(ExceptionSink* xsink, PyObject* mod, const char* module, int filter);
 
+    //! Imports the builtins module using the shared builtins namespace
+    DLLLOCAL int importBuiltins(ExceptionSink* xsink);
+
+    //! Returns the shared builtins namespace, creating it on first use; the GIL must be held
+    DLLLOCAL static const QoreNamespace* getBuiltinsNamespace(PyObject* mod);
+
+    //! Returns the shared builtins namespace, creating it with the main interpreter if necessary
+    /** acquires the GIL only if the namespace has not been created yet; returns nullptr on error
+    */
+    DLLLOCAL static const QoreNamespace* getBuiltinsNamespace();
+
+    //! Sets the class handler for lazy class creation on the namespace for the given module
+    /** @return true if classes will be created on demand, false if not supported
+    */
+    DLLLOCAL bool setLazyClassHandler(const char* module);
+
+    //! Namespace class handler; creates Qore classes for Python classes on demand
+    DLLLOCAL static QoreClass* lazyClassHandler(QoreNamespace* ns, const char* cname);
+
     //! Saves the module in sys.modules
     DLLLOCAL int saveModule(const char* name, PyObject* mod);
 
@@ -575,6 +906,11 @@ protected:
             ExceptionSink* xsink);
     DLLLOCAL static QoreValue execPythonFunction(PyObject* func, const QoreListNode* args, q_rt_flags_t rtflags,
             ExceptionSink* xsink);
+    DLLLOCAL static QoreValue execPythonBuiltinFunction(const char* name, const QoreListNode* args,
+            q_rt_flags_t rtflags, ExceptionSink* xsink);
+
+    //! Calls the given builtin function in the current interpreter
+    DLLLOCAL QoreValue callBuiltinFunction(ExceptionSink* xsink, const char* name, const QoreListNode* args);
 
     //! Python integration
     DLLLOCAL static PyObject* callQoreFunction(PyObject* self, PyObject* args);
@@ -589,6 +925,49 @@ protected:
     //! the GIL must be held when this function is called
     DLLLOCAL int createInterpreter(QorePythonGilHelper& qpgh, ExceptionSink* xsink);
 
+    //! Returns a new thread state in the shared interpreter, creating the interpreter if necessary
+    /** must be called with py_thr_lck held and the GIL held
+
+        @param created set to false if the interpreter already existed
+    */
+    DLLLOCAL PyThreadState* getSharedInterpreterThreadStateIntern(bool& created);
+
+    typedef std::vector<PyThreadState*> thr_state_vec_t;
+
+    //! Removes all thread states for this program from the thread-state registry; py_thr_lck must be held
+    /** @param states if not nullptr, the thread states removed are added to the vector
+    */
+    DLLLOCAL void removeThreadStatesIntern(thr_state_vec_t* states);
+
+    //! Returns the Qore zone for the given Python tzinfo object and datetime; the GIL must be held
+    /** @return the zone or nullptr if the UTC offset could not be determined (no Python exception is raised)
+    */
+    DLLLOCAL const AbstractQoreZoneInfo* getZoneFromTzinfo(PyObject* tzinfo, PyObject* val);
+
+    //! Returns a borrowed reference to a Python timezone object for the given UTC offset; the GIL must be held
+    DLLLOCAL PyObject* getPythonTimezone(int utc_offset);
+
+    //! Releases the timezone caches; the GIL must be held
+    DLLLOCAL void purgeTimezoneCaches();
+
+    //! Deletes the Python class wrappers for Qore classes; the GIL must be held
+    DLLLOCAL void deleteClasses();
+
+    //! Invalidates the program in a forked child process where its interpreter no longer exists
+    /** references to Python objects are abandoned, as the objects were freed with the interpreter
+    */
+    DLLLOCAL void invalidateAfterFork();
+
+    //! Deletes the program's thread states and releases the shared interpreter
+    /** @param last the entry removed from the shared interpreter map if this program was the last user; the
+        interpreter is deleted along with the programs retained by it
+    */
+    DLLLOCAL void releaseSharedInterpreter(const thr_state_vec_t& thr_states, QorePythonSharedInterpreter* last);
+
+    //! Creates the interpreter and executes the given source or marshaled code as the program's module
+    DLLLOCAL void initSourceIntern(QorePythonGilHelper& qpgh, ExceptionSink* xsink, const char* src_code, int start,
+        const std::string* code);
+
     //! Returns the Python thread state for this interpreter
     DLLLOCAL PyThreadState* getAcquireThreadState() const {
         AutoLocker al(py_thr_lck);
@@ -643,10 +1022,30 @@ protected:
 class QorePythonProgramData : public AbstractPrivateData, public QorePythonProgram {
 public:
    DLLLOCAL QorePythonProgramData(const QoreString& source_code, const QoreString& source_label, int start,
-        ExceptionSink* xsink) : QorePythonProgram(source_code, source_label, start, xsink) {
+        ExceptionSink* xsink, const char* interp_name = nullptr)
+        : QorePythonProgram(source_code, source_label, start, xsink, interp_name) {
         //printd(5, "QorePythonProgramData::QorePythonProgramData() this: %p\n", this);
     }
 
+    DLLLOCAL QorePythonProgramData(const std::shared_ptr<const std::string>& code, const std::string& source_label,
+        const std::string& interp_name, ExceptionSink* xsink)
+        : QorePythonProgram(code, source_label, interp_name, xsink) {
+    }
+
+    //! Creates a new program from this program's compiled code
+    /** the new program is created in the same shared interpreter as this program, if any, otherwise in a new
+        interpreter
+    */
+    DLLLOCAL QorePythonProgramData* clone(ExceptionSink* xsink) {
+        std::shared_ptr<const std::string> code = getCloneCode(xsink);
+        if (!code) {
+            return nullptr;
+        }
+        ReferenceHolder<QorePythonProgramData> rv(new QorePythonProgramData(code, source_label, interp_name, xsink),
+            xsink);
+        return *xsink ? nullptr : rv.release();
+    }
+
     using AbstractPrivateData::deref;
     DLLLOCAL virtual void deref(ExceptionSink* xsink) {
         if (ROdereference()) {
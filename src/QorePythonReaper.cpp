@@ -0,0 +1,198 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonReaper.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#include "QorePythonReaper.h"
+#include "QorePythonProgram.h"
+#include "QoreThreadAttachHelper.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+std::atomic<bool> QorePythonReaper::enabled(false);
+
+namespace {
+//! global reaper data
+struct reaper_data {
+    QoreThreadLock lck;
+    //! signaled when an interpreter is queued or the thread should stop
+    QoreCondition cond;
+    //! signaled when the queue has been drained
+    QoreCondition idle_cond;
+    //! interpreters waiting to be finalized
+    std::deque<PyInterpreterState*> queue;
+    std::thread thr;
+    //! the number of interpreters queued and not yet finalized, including the one currently being finalized
+    size_t pending = 0;
+    //! the number of interpreters finalized
+    uint64_t reaped = 0;
+    //! the total time spent finalizing interpreters in nanoseconds
+    uint64_t total_ns = 0;
+    //! the longest time spent finalizing a single interpreter in nanoseconds
+    uint64_t max_ns = 0;
+    bool stop = false;
+};
+}
+
+static reaper_data*& get_data_ptr() {
+    // never destroyed to allow for use when the module is unloaded
+    static reaper_data* data = new reaper_data;
+    return data;
+}
+
+static reaper_data& get_data() {
+    return *get_data_ptr();
+}
+
+static void reaper_main() {
+    reaper_data& d = get_data();
+
+    // Python objects being destroyed may hold references to Qore values
+    QoreThreadAttachHelper attach_helper;
+    attach_helper.attach();
+
+    while (true) {
+        PyInterpreterState* interpreter;
+        {
+            AutoLocker al(d.lck);
+            while (d.queue.empty() && !d.stop) {
+                d.cond.wait(&d.lck);
+            }
+            // queued interpreters are always finalized before the thread exits
+            if (d.queue.empty()) {
+                break;
+            }
+            interpreter = d.queue.front();
+            d.queue.pop_front();
+        }
+
+        uint64_t start = q_python_now_ns();
+        if (!python_shutdown) {
+            // grab the GIL with the main thread lock; the interpreter is no longer in the thread-state registry, so
+            // the global thread lock is not needed
+            QorePythonGilHelper pgh;
+            assert(_qore_PyRuntimeGILState_GetThreadState());
+            PyInterpreterState_Clear(interpreter);
+            PyInterpreterState_Delete(interpreter);
+        }
+        uint64_t ns = q_python_now_ns() - start;
+        printd(5, "reaper_main() finalized interpreter %p in " QLLD " ns\n", interpreter, (int64)ns);
+
+        AutoLocker al(d.lck);
+        ++d.reaped;
+        d.total_ns += ns;
+        if (ns > d.max_ns) {
+            d.max_ns = ns;
+        }
+        assert(d.pending);
+        if (!--d.pending) {
+            d.idle_cond.broadcast();
+        }
+    }
+}
+
+void QorePythonReaper::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+    if (!enable) {
+        stop();
+    }
+}
+
+void QorePythonReaper::initFromEnvironment() {
+    const char* val = getenv("QORE_PYTHON_ASYNC_TEARDOWN");
+    if (val && *val && strcmp(val, "0")) {
+        setEnabled(true);
+    }
+}
+
+void QorePythonReaper::queue(PyInterpreterState* interpreter) {
+    reaper_data& d = get_data();
+    AutoLocker al(d.lck);
+    d.queue.push_back(interpreter);
+    ++d.pending;
+    if (!d.thr.joinable()) {
+        d.stop = false;
+        d.thr = std::thread(reaper_main);
+    } else {
+        d.cond.signal();
+    }
+}
+
+int QorePythonReaper::wait(int timeout_ms) {
+    reaper_data& d = get_data();
+    AutoLocker al(d.lck);
+    while (d.pending) {
+        if (timeout_ms > 0) {
+            if (d.idle_cond.wait(&d.lck, timeout_ms)) {
+                return d.pending ? -1 : 0;
+            }
+        } else {
+            d.idle_cond.wait(&d.lck);
+        }
+    }
+    return 0;
+}
+
+void QorePythonReaper::stop() {
+    reaper_data& d = get_data();
+    std::thread thr;
+    {
+        AutoLocker al(d.lck);
+        if (!d.thr.joinable()) {
+            return;
+        }
+        d.stop = true;
+        d.cond.signal();
+        thr = std::move(d.thr);
+    }
+    thr.join();
+}
+
+void QorePythonReaper::afterForkChild() {
+    // the reaper thread does not exist in the child, and its lock may have been held at the time of the fork; the old
+    // data is abandoned, as the thread object cannot be joined or destroyed; queued interpreters are not finalized
+    get_data_ptr() = new reaper_data;
+}
+
+QoreHashNode* QorePythonReaper::getInfo() {
+    reaper_data& d = get_data();
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), nullptr);
+    rv->setKeyValue("enabled", isEnabled(), nullptr);
+    AutoLocker al(d.lck);
+    rv->setKeyValue("running", d.thr.joinable(), nullptr);
+    rv->setKeyValue("pending", (int64)d.pending, nullptr);
+    rv->setKeyValue("reaped", (int64)d.reaped, nullptr);
+    rv->setKeyValue("total_ns", (int64)d.total_ns, nullptr);
+    rv->setKeyValue("max_ns", (int64)d.max_ns, nullptr);
+    return rv.release();
+}
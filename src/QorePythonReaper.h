@@ -0,0 +1,87 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonReaper.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#ifndef _QORE_QOREPYTHONREAPER_H
+
+#define _QORE_QOREPYTHONREAPER_H
+
+#include "python-module.h"
+
+#include <atomic>
+
+//! optional background thread for finalizing Python interpreters of destroyed programs
+/** when enabled, programs hand their interpreters to the reaper thread after the thread-state registry entries have
+    been removed, so the destroying thread does not wait for \c PyInterpreterState_Clear() and the global thread
+    lock is not held while the interpreter is being finalized
+*/
+class QorePythonReaper {
+public:
+    //! returns true if asynchronous teardown is enabled
+    DLLLOCAL static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    //! enables or disables asynchronous teardown
+    /** when disabled, interpreters already queued are finalized and the reaper thread is stopped, so that the
+        process can be forked
+    */
+    DLLLOCAL static void setEnabled(bool enable);
+
+    //! sets the configuration from the environment, if present
+    DLLLOCAL static void initFromEnvironment();
+
+    //! queues the interpreter for finalization; starts the reaper thread if necessary
+    /** the interpreter must no longer be referenced in any thread-state registry
+    */
+    DLLLOCAL static void queue(PyInterpreterState* interpreter);
+
+    //! waits until all queued interpreters have been finalized
+    /** @param timeout_ms the maximum time to wait in milliseconds; 0 = wait indefinitely
+
+        @return 0 if all interpreters have been finalized, -1 if the timeout expired
+    */
+    DLLLOCAL static int wait(int timeout_ms = 0);
+
+    //! finalizes all queued interpreters and stops the reaper thread; called when the module is unloaded
+    DLLLOCAL static void stop();
+
+    //! resets the reaper state in a forked child process; must be called before any other thread is started
+    DLLLOCAL static void afterForkChild();
+
+    //! returns a hash describing the reaper state and statistics
+    DLLLOCAL static QoreHashNode* getInfo();
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+};
+
+#endif
@@ -0,0 +1,394 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonSampler.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QorePythonSampler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> QorePythonSampler::active(false);
+
+namespace {
+//! a frame recorded when crossing the Qore / Python boundary
+struct sample_frame {
+    //! the Qore frame label; "<qore>" for calls from Qore to Python
+    std::string label;
+    //! the top Python frame when the boundary was crossed, used to stitch the stack; nullptr if none
+    const void* py_frame;
+};
+
+typedef std::vector<sample_frame> sample_stack_t;
+
+//! boundary frames for a thread; only modified and read with the GIL held
+struct sample_thread {
+    sample_stack_t stack;
+};
+
+typedef std::map<unsigned long, std::shared_ptr<sample_thread>> sample_thread_map_t;
+typedef std::map<std::string, uint64_t> sample_map_t;
+
+//! global sampler data
+struct sampler_data {
+    QoreThreadLock lck;
+    QoreCondition cond;
+    //! threads registered with the sampler keyed by Python thread ident
+    sample_thread_map_t thread_map;
+    //! aggregated samples keyed by collapsed stack
+    sample_map_t samples;
+    std::thread thr;
+    int interval_ms = 0;
+    bool stop = false;
+};
+
+//! registers the current thread with the sampler and removes the registration when the thread terminates
+struct sample_thread_reg {
+    std::shared_ptr<sample_thread> rec;
+    unsigned long ident = 0;
+
+    DLLLOCAL ~sample_thread_reg();
+};
+}
+
+static sampler_data*& get_data_ptr() {
+    // never destroyed to allow for use in thread-local destructors at exit
+    static sampler_data* data = new sampler_data;
+    return data;
+}
+
+static sampler_data& get_data() {
+    return *get_data_ptr();
+}
+
+static thread_local sample_thread_reg sample_reg;
+
+sample_thread_reg::~sample_thread_reg() {
+    if (rec) {
+        sampler_data& d = get_data();
+        AutoLocker al(d.lck);
+        d.thread_map.erase(ident);
+    }
+}
+
+static sample_thread& get_thread_rec() {
+    if (!sample_reg.rec) {
+        sample_reg.rec = std::make_shared<sample_thread>();
+        sample_reg.ident = PyThread_get_thread_ident();
+        sampler_data& d = get_data();
+        AutoLocker al(d.lck);
+        d.thread_map[sample_reg.ident] = sample_reg.rec;
+    }
+    return *sample_reg.rec;
+}
+
+//! returns the label for the given Python code object as "name (file:line)"
+static std::string get_code_label(PyCodeObject* code) {
+#if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION > 10
+    const char* name = PyUnicode_AsUTF8(code->co_qualname);
+#else
+    const char* name = PyUnicode_AsUTF8(code->co_name);
+#endif
+    const char* file = PyUnicode_AsUTF8(code->co_filename);
+    if (!name || !file) {
+        PyErr_Clear();
+        return "<unknown>";
+    }
+    const char* p = strrchr(file, '/');
+    if (p) {
+        file = p + 1;
+    }
+    QoreStringMaker str("%s (%s:%d)", name, file, code->co_firstlineno);
+    return str.c_str();
+}
+
+//! returns the Python frames for the given top frame from the outermost to the innermost; must hold the GIL
+static void get_python_stack(PyFrameObject* frame, std::vector<std::pair<const void*, std::string>>& py_stack) {
+#if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION > 8
+    Py_XINCREF(frame);
+    while (frame) {
+        PyCodeObject* code = PyFrame_GetCode(frame);
+        py_stack.push_back(std::make_pair(frame, get_code_label(code)));
+        Py_DECREF(code);
+        PyFrameObject* back = PyFrame_GetBack(frame);
+        Py_DECREF(frame);
+        frame = back;
+    }
+#else
+    while (frame) {
+        py_stack.push_back(std::make_pair(frame, get_code_label(frame->f_code)));
+        frame = frame->f_back;
+    }
+#endif
+    std::reverse(py_stack.begin(), py_stack.end());
+}
+
+//! stitches Python and boundary frames into a collapsed stack string
+static std::string get_collapsed_stack(const sample_stack_t& stack, PyFrameObject* frame) {
+    std::vector<std::pair<const void*, std::string>> py_stack;
+    get_python_stack(frame, py_stack);
+
+    std::string rv;
+    auto add = [&rv](const std::string& label) {
+        if (!rv.empty()) {
+            rv += ';';
+        }
+        size_t start = rv.size();
+        rv += label;
+        // ';' separates frames and '\n' separates stacks in the output
+        for (size_t i = start; i < rv.size(); ++i) {
+            if (rv[i] == ';') {
+                rv[i] = ':';
+            } else if (rv[i] == '\n') {
+                rv[i] = ' ';
+            }
+        }
+    };
+
+    size_t pi = 0;
+    for (auto& i : stack) {
+        // add all Python frames up to the frame where the boundary was crossed
+        if (i.py_frame) {
+            size_t j = pi;
+            while (j < py_stack.size() && py_stack[j].first != i.py_frame) {
+                ++j;
+            }
+            if (j < py_stack.size()) {
+                for (; pi <= j; ++pi) {
+                    add(py_stack[pi].second);
+                }
+            }
+        }
+        add(i.label);
+    }
+    for (; pi < py_stack.size(); ++pi) {
+        add(py_stack[pi].second);
+    }
+    return rv;
+}
+
+//! takes a sample of all threads in a boundary call; must hold the GIL
+static void take_sample(sampler_data& d) {
+    // the boundary stacks are copied with the lock held; Python APIs are only called after the lock is released to
+    // avoid a lock-order inversion with threads holding the GIL that call into the sampler
+    typedef std::vector<std::pair<unsigned long, sample_stack_t>> thread_vec_t;
+    thread_vec_t threads;
+    {
+        AutoLocker al(d.lck);
+        for (auto& i : d.thread_map) {
+            // the stacks are only modified with the GIL held, so they cannot change while they are copied
+            if (!i.second->stack.empty()) {
+                threads.push_back(std::make_pair(i.first, i.second->stack));
+            }
+        }
+    }
+    if (threads.empty()) {
+        return;
+    }
+
+    std::vector<std::string> stacks;
+    {
+        // returns a new reference
+        QorePythonReferenceHolder frames(_PyThread_CurrentFrames());
+        if (!frames) {
+            PyErr_Clear();
+            return;
+        }
+
+        for (auto& i : threads) {
+            QorePythonReferenceHolder key(PyLong_FromUnsignedLong(i.first));
+            // returns a borrowed reference
+            PyObject* frame = PyDict_GetItem(*frames, *key);
+            stacks.push_back(get_collapsed_stack(i.second, reinterpret_cast<PyFrameObject*>(frame)));
+        }
+    }
+
+    if (!stacks.empty()) {
+        AutoLocker al(d.lck);
+        for (auto& i : stacks) {
+            ++d.samples[i];
+        }
+    }
+}
+
+static void sampler_main() {
+    sampler_data& d = get_data();
+
+    // the thread state must be created in this thread
+    PyThreadState* tstate = PyThreadState_New(mainThreadState->interp);
+    // the new thread state is not current, so the GIL is not held here
+    while (true) {
+        {
+            AutoLocker al(d.lck);
+            if (!d.stop) {
+                d.cond.wait(&d.lck, d.interval_ms);
+            }
+            if (d.stop) {
+                break;
+            }
+        }
+        if (python_shutdown) {
+            break;
+        }
+
+        PyEval_RestoreThread(tstate);
+        take_sample(d);
+        PyEval_SaveThread();
+    }
+
+    if (!python_shutdown) {
+        PyEval_RestoreThread(tstate);
+        PyThreadState_Clear(tstate);
+        PyThreadState_DeleteCurrent();
+    }
+}
+
+int QorePythonSampler::start(ExceptionSink* xsink, int64 interval_ms) {
+    if (interval_ms <= 0) {
+        xsink->raiseException("PYTHON-SAMPLER-ERROR", "the sampling interval must be greater than zero; got: "
+            QLLD, interval_ms);
+        return -1;
+    }
+
+    sampler_data& d = get_data();
+    AutoLocker al(d.lck);
+    if (isActive() || d.thr.joinable()) {
+        xsink->raiseException("PYTHON-SAMPLER-ERROR", "the sampling profiler is already running");
+        return -1;
+    }
+    d.interval_ms = (int)interval_ms;
+    d.stop = false;
+    d.thr = std::thread(sampler_main);
+    active.store(true, std::memory_order_relaxed);
+    return 0;
+}
+
+void QorePythonSampler::stop() {
+    sampler_data& d = get_data();
+    std::thread thr;
+    {
+        AutoLocker al(d.lck);
+        if (!d.thr.joinable()) {
+            return;
+        }
+        active.store(false, std::memory_order_relaxed);
+        d.stop = true;
+        d.cond.signal();
+        thr = std::move(d.thr);
+    }
+    // the sampler thread needs the GIL to take its last sample and to delete its thread state
+    if (_qore_has_gil()) {
+        QorePythonReleaseGilHelper rgh;
+        thr.join();
+    } else {
+        thr.join();
+    }
+}
+
+void QorePythonSampler::afterForkChild() {
+    // the sampler thread does not exist in the child, and its lock may have been held at the time of the fork; the
+    // old data is abandoned, as the thread object cannot be joined or destroyed
+    active.store(false, std::memory_order_relaxed);
+    get_data_ptr() = new sampler_data;
+    // the forking thread is registered again with the new data on its next boundary call
+    sample_reg.rec.reset();
+}
+
+QoreStringNode* QorePythonSampler::getCollapsed() {
+    sampler_data& d = get_data();
+    SimpleRefHolder<QoreStringNode> rv(new QoreStringNode(QCS_UTF8));
+    AutoLocker al(d.lck);
+    for (auto& i : d.samples) {
+        rv->sprintf("%s " QLLD "\n", i.first.c_str(), (int64)i.second);
+    }
+    return rv.release();
+}
+
+int QorePythonSampler::writeCollapsed(ExceptionSink* xsink, const char* path) {
+    SimpleRefHolder<QoreStringNode> str(getCollapsed());
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        xsink->raiseErrnoException("PYTHON-SAMPLER-ERROR", errno, "cannot open '%s' for writing", path);
+        return -1;
+    }
+    size_t len = str->size();
+    bool ok = fwrite(str->c_str(), 1, len, fp) == len;
+    if (fclose(fp) || !ok) {
+        xsink->raiseErrnoException("PYTHON-SAMPLER-ERROR", errno, "error writing to '%s'", path);
+        return -1;
+    }
+    return 0;
+}
+
+void QorePythonSampler::reset() {
+    sampler_data& d = get_data();
+    AutoLocker al(d.lck);
+    d.samples.clear();
+}
+
+bool QorePythonSampler::push(const char* cls, const char* name) {
+    sample_thread& rec = get_thread_rec();
+
+    sample_frame f;
+    if (name) {
+        if (cls) {
+            f.label = cls;
+            f.label += "::";
+        }
+        f.label += name;
+        f.label += " [qore]";
+    } else {
+        f.label = "<qore>";
+    }
+
+    PyThreadState* tstate = PyThreadState_Get();
+#if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION > 8
+    // returns a new reference; only the address is used to identify the frame
+    PyFrameObject* frame = PyThreadState_GetFrame(tstate);
+    f.py_frame = frame;
+    Py_XDECREF(frame);
+#else
+    f.py_frame = tstate->frame;
+#endif
+    rec.stack.push_back(f);
+    return true;
+}
+
+void QorePythonSampler::pop() {
+    assert(sample_reg.rec);
+    assert(!sample_reg.rec->stack.empty());
+    sample_reg.rec->stack.pop_back();
+}
@@ -0,0 +1,85 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonSampler.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_QOREPYTHONSAMPLER_H
+
+#define _QORE_QOREPYTHONSAMPLER_H
+
+#include "python-module.h"
+
+#include <atomic>
+
+//! sampling profiler producing combined Qore / Python stacks in collapsed-stack format
+/** a timer thread periodically acquires the GIL and samples the Python frames of all threads that are currently
+    executing a call across the Qore / Python boundary; boundary frames recorded by each thread are stitched between
+    the Python frames to produce a single mixed-language stack
+*/
+class QorePythonSampler {
+public:
+    //! returns true if the sampler is running
+    DLLLOCAL static bool isActive() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    //! starts the sampler thread with the given interval in milliseconds
+    DLLLOCAL static int start(ExceptionSink* xsink, int64 interval_ms);
+
+    //! stops the sampler thread; samples are retained until reset() is called
+    DLLLOCAL static void stop();
+
+    //! returns aggregated samples in collapsed-stack format; one "frame;frame;... count" line per stack
+    DLLLOCAL static QoreStringNode* getCollapsed();
+
+    //! writes aggregated samples in collapsed-stack format to the given file
+    DLLLOCAL static int writeCollapsed(ExceptionSink* xsink, const char* path);
+
+    //! discards all samples
+    DLLLOCAL static void reset();
+
+    //! resets the sampler state in a forked child process; samples are discarded and the sampler is stopped
+    DLLLOCAL static void afterForkChild();
+
+    //! pushes a boundary frame for the current thread; must be called with the GIL held
+    /** @param cls the Qore class name for Qore methods called from Python, otherwise nullptr
+        @param name the Qore function or method name for calls from Python, or nullptr for calls to Python
+
+        @return true if the frame was pushed and must be popped with pop()
+    */
+    DLLLOCAL static bool push(const char* cls, const char* name);
+
+    //! pops the last boundary frame for the current thread
+    DLLLOCAL static void pop();
+
+private:
+    DLLLOCAL static std::atomic<bool> active;
+};
+
+#endif
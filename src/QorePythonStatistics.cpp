@@ -0,0 +1,143 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonStatistics.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#include "QorePythonStatistics.h"
+
+QorePythonStatistics QorePythonStatistics::global;
+std::atomic<bool> QorePythonStatistics::enabled(false);
+
+constexpr unsigned QorePythonHistogram::NUM_BUCKETS;
+
+static const char* stat_names[QPS_NUM_STATS] = {
+    "context_entries",
+    "context_reentries",
+    "gil_acquisitions",
+    "gil_wait_ns",
+    "qore_to_python_calls",
+    "python_to_qore_calls",
+    "bytes_to_python",
+    "bytes_to_qore",
+    "wrappers_created",
+    "exceptions_to_qore",
+    "exceptions_to_python",
+    "thread_states_created",
+};
+
+static const char* conv_names[QPC_NUM_TYPES] = {
+    "none",
+    "bool",
+    "int",
+    "number",
+    "float",
+    "string",
+    "binary",
+    "date",
+    "list",
+    "hash",
+    "callable",
+    "object",
+};
+
+void QorePythonStatistics::reset() {
+    for (unsigned i = 0; i < QPS_NUM_STATS; ++i) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < QPC_NUM_TYPES; ++i) {
+        to_python[i].store(0, std::memory_order_relaxed);
+        to_qore[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+QoreHashNode* QorePythonStatistics::getHash() const {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(bigIntTypeInfo), nullptr);
+    for (unsigned i = 0; i < QPS_NUM_STATS; ++i) {
+        rv->setKeyValue(stat_names[i], (int64)counters[i].load(std::memory_order_relaxed), nullptr);
+    }
+
+    ReferenceHolder<QoreHashNode> to_py(new QoreHashNode(bigIntTypeInfo), nullptr);
+    ReferenceHolder<QoreHashNode> to_q(new QoreHashNode(bigIntTypeInfo), nullptr);
+    for (unsigned i = 0; i < QPC_NUM_TYPES; ++i) {
+        to_py->setKeyValue(conv_names[i], (int64)to_python[i].load(std::memory_order_relaxed), nullptr);
+        to_q->setKeyValue(conv_names[i], (int64)to_qore[i].load(std::memory_order_relaxed), nullptr);
+    }
+
+    ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), nullptr);
+    h->setKeyValue("counters", rv.release(), nullptr);
+    h->setKeyValue("conversions_to_python", to_py.release(), nullptr);
+    h->setKeyValue("conversions_to_qore", to_q.release(), nullptr);
+    return h.release();
+}
+
+void QorePythonHistogram::reset() {
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t QorePythonHistogram::getPercentile(double p) const {
+    uint64_t cnt = getCount();
+    if (!cnt) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * cnt);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+        sum += buckets[i].load(std::memory_order_relaxed);
+        if (sum >= rank) {
+            // use the upper bound of the bucket, limited by the maximum value seen
+            uint64_t upper = (i == NUM_BUCKETS - 1) ? getMax() : ((uint64_t)2 << i) - 1;
+            uint64_t m = getMax();
+            return upper < m ? upper : m;
+        }
+    }
+    return getMax();
+}
+
+QoreHashNode* QorePythonHistogram::getHash() const {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(bigIntTypeInfo), nullptr);
+    uint64_t cnt = getCount();
+    uint64_t tot = getTotal();
+    rv->setKeyValue("count", (int64)cnt, nullptr);
+    rv->setKeyValue("total_ns", (int64)tot, nullptr);
+    rv->setKeyValue("avg_ns", (int64)(cnt ? tot / cnt : 0), nullptr);
+    rv->setKeyValue("max_ns", (int64)getMax(), nullptr);
+    rv->setKeyValue("p50_ns", (int64)getPercentile(0.5), nullptr);
+    rv->setKeyValue("p90_ns", (int64)getPercentile(0.9), nullptr);
+    rv->setKeyValue("p99_ns", (int64)getPercentile(0.99), nullptr);
+    rv->setKeyValue("p999_ns", (int64)getPercentile(0.999), nullptr);
+    return rv.release();
+}
@@ -0,0 +1,187 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonStatistics.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+#ifndef _QORE_QOREPYTHONSTATISTICS_H
+
+#define _QORE_QOREPYTHONSTATISTICS_H
+
+#include <qore/Qore.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//! bridge statistics counters
+enum qore_python_stat_e : unsigned {
+    QPS_CONTEXT_ENTRIES = 0,        //!< Python thread context entries
+    QPS_CONTEXT_REENTRIES,          //!< nested context entries where the GIL was already held
+    QPS_GIL_ACQUISITIONS,           //!< GIL acquisitions
+    QPS_GIL_WAIT_NS,                //!< total time waiting for the GIL in nanoseconds
+    QPS_QORE_TO_PYTHON_CALLS,       //!< calls from Qore to Python
+    QPS_PYTHON_TO_QORE_CALLS,       //!< calls from Python to Qore
+    QPS_BYTES_TO_PYTHON,            //!< string and binary bytes converted from Qore to Python
+    QPS_BYTES_TO_QORE,              //!< string and binary bytes converted from Python to Qore
+    QPS_WRAPPERS_CREATED,           //!< wrapper objects created in both directions
+    QPS_EXCEPTIONS_TO_QORE,         //!< Python exceptions raised in Qore
+    QPS_EXCEPTIONS_TO_PYTHON,       //!< Qore exceptions raised in Python
+    QPS_THREAD_STATES_CREATED,      //!< Python thread states created
+
+    QPS_NUM_STATS
+};
+
+//! value types for conversion statistics
+enum qore_python_conv_e : unsigned {
+    QPC_NONE = 0,
+    QPC_BOOL,
+    QPC_INT,
+    QPC_NUMBER,
+    QPC_FLOAT,
+    QPC_STRING,
+    QPC_BINARY,
+    QPC_DATE,
+    QPC_LIST,
+    QPC_HASH,
+    QPC_CALLABLE,
+    QPC_OBJECT,
+
+    QPC_NUM_TYPES
+};
+
+//! atomic bridge statistics; one instance per program plus a global instance
+/** statistics are only collected if enabled with setEnabled(); callers must check isEnabled() before updating
+    counters
+*/
+class QorePythonStatistics {
+public:
+    DLLLOCAL QorePythonStatistics() {
+        reset();
+    }
+
+    //! returns true if statistics are collected
+    DLLLOCAL static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    //! enables or disables statistics collection for all programs
+    DLLLOCAL static void setEnabled(bool enable) {
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    DLLLOCAL void inc(qore_python_stat_e stat, uint64_t val = 1) {
+        counters[stat].fetch_add(val, std::memory_order_relaxed);
+    }
+
+    DLLLOCAL void incToPython(qore_python_conv_e type) {
+        to_python[type].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    DLLLOCAL void incToQore(qore_python_conv_e type) {
+        to_qore[type].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! resets all counters
+    DLLLOCAL void reset();
+
+    //! returns a hash of all counters
+    DLLLOCAL QoreHashNode* getHash() const;
+
+    //! global statistics for all programs
+    DLLLOCAL static QorePythonStatistics global;
+
+private:
+    DLLLOCAL static std::atomic<bool> enabled;
+
+    std::atomic<uint64_t> counters[QPS_NUM_STATS];
+    std::atomic<uint64_t> to_python[QPC_NUM_TYPES];
+    std::atomic<uint64_t> to_qore[QPC_NUM_TYPES];
+};
+
+//! lock-free latency histogram with power-of-two nanosecond buckets
+class QorePythonHistogram {
+public:
+    //! number of buckets; bucket n holds values in the range [2^n, 2^(n + 1)) ns
+    static constexpr unsigned NUM_BUCKETS = 48;
+
+    DLLLOCAL QorePythonHistogram() {
+        reset();
+    }
+
+    //! adds a value in nanoseconds
+    DLLLOCAL void add(uint64_t ns) {
+        buckets[getBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = max.load(std::memory_order_relaxed);
+        while (ns > m && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    DLLLOCAL uint64_t getCount() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    DLLLOCAL uint64_t getTotal() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    DLLLOCAL uint64_t getMax() const {
+        return max.load(std::memory_order_relaxed);
+    }
+
+    //! returns the estimated value for the given percentile (0.0 - 1.0) in nanoseconds
+    DLLLOCAL uint64_t getPercentile(double p) const;
+
+    //! resets the histogram
+    DLLLOCAL void reset();
+
+    //! returns a hash with count, total_ns, avg_ns, max_ns, p50_ns, p90_ns, p99_ns, and p999_ns keys
+    DLLLOCAL QoreHashNode* getHash() const;
+
+    //! returns the bucket for the given value
+    DLLLOCAL static unsigned getBucket(uint64_t ns) {
+        unsigned b = ns ? 63 - __builtin_clzll(ns) : 0;
+        return b < NUM_BUCKETS ? b : NUM_BUCKETS - 1;
+    }
+
+private:
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> max;
+};
+
+//! returns a monotonic timestamp in nanoseconds
+DLLLOCAL static inline uint64_t q_python_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
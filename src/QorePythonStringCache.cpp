@@ -0,0 +1,152 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonStringCache.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#include "QorePythonStringCache.h"
+
+#include <cstring>
+
+constexpr size_t QorePythonStringCache::MAX_KEY_LEN;
+constexpr size_t QorePythonStringCache::MAX_VALUE_LEN;
+constexpr size_t QorePythonStringCache::MAX_ENTRIES;
+constexpr size_t QorePythonStringCache::MIN_TABLE_SIZE;
+
+//! FNV-1a hash
+static inline size_t str_cache_hash(const char* str, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)str[i];
+        h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+}
+
+PyObject* QorePythonStringCache::getPythonString(const char* str, size_t len) {
+    if (py_count == MAX_ENTRIES) {
+        purgePython();
+    }
+    if (py_table.empty()) {
+        py_table.resize(MIN_TABLE_SIZE, py_entry_t {nullptr, nullptr, 0, 0});
+    } else if (py_count * 2 >= py_table.size() && py_table.size() < MAX_ENTRIES * 2) {
+        // keep the load factor at or below 1/2
+        growPython();
+    }
+
+    size_t hash = str_cache_hash(str, len);
+    size_t mask = py_table.size() - 1;
+    size_t i = hash & mask;
+    for (; py_table[i].obj; i = (i + 1) & mask) {
+        py_entry_t& e = py_table[i];
+        if (e.hash == hash && e.len == len && !memcmp(e.str, str, len)) {
+            Py_INCREF(e.obj);
+            return e.obj;
+        }
+    }
+
+    PyObject* obj = PyUnicode_FromStringAndSize(str, len);
+    if (!obj) {
+        return nullptr;
+    }
+    PyUnicode_InternInPlace(&obj);
+    Py_ssize_t size;
+    const char* utf8 = PyUnicode_AsUTF8AndSize(obj, &size);
+    if (!utf8) {
+        PyErr_Clear();
+        return obj;
+    }
+    Py_INCREF(obj);
+    py_table[i] = {obj, utf8, (size_t)size, hash};
+    ++py_count;
+    return obj;
+}
+
+QoreStringNode* QorePythonStringCache::getQoreString(PyObject* val, const char* str, size_t len) {
+    qore_map_t::iterator i = qore_map.find(val);
+    if (i != qore_map.end()) {
+        return i->second->stringRefSelf();
+    }
+
+    if (qore_map.size() == MAX_ENTRIES) {
+        purgeQore();
+    }
+    QoreStringNode* rv = new QoreStringNode(str, len, QCS_UTF8);
+    Py_INCREF(val);
+    qore_map.insert(qore_map_t::value_type(val, rv));
+    return rv->stringRefSelf();
+}
+
+void QorePythonStringCache::purge() {
+    purgePython();
+    purgeQore();
+}
+
+void QorePythonStringCache::growPython() {
+    py_table_t new_table(py_table.size() * 2, py_entry_t {nullptr, nullptr, 0, 0});
+    size_t mask = new_table.size() - 1;
+    for (auto& e : py_table) {
+        if (e.obj) {
+            size_t i = e.hash & mask;
+            while (new_table[i].obj) {
+                i = (i + 1) & mask;
+            }
+            new_table[i] = e;
+        }
+    }
+    py_table.swap(new_table);
+}
+
+void QorePythonStringCache::purgePython() {
+    for (auto& e : py_table) {
+        if (e.obj) {
+            Py_DECREF(e.obj);
+            e = {nullptr, nullptr, 0, 0};
+        }
+    }
+    py_count = 0;
+}
+
+void QorePythonStringCache::purgeQore() {
+    for (auto& i : qore_map) {
+        Py_DECREF(i.first);
+        i.second->deref();
+    }
+    qore_map.clear();
+}
+
+void QorePythonStringCache::abandon() {
+    // the Qore strings can still be released
+    for (auto& i : qore_map) {
+        i.second->deref();
+    }
+    qore_map.clear();
+    py_table_t().swap(py_table);
+    py_count = 0;
+}
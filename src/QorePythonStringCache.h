@@ -0,0 +1,115 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QorePythonStringCache.h
+
+    Qore Programming Language
+
+    Copyright (C) 2020 - 2022 Qore Technologies, s.r.o.
+
+    Permission is hereby granted, free of charge, to any person obtaining a
+    copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+    Note that the Qore library is released under a choice of three open-source
+    licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+    information.
+*/
+
+
+#ifndef _QORE_QOREPYTHONSTRINGCACHE_H
+
+#define _QORE_QOREPYTHONSTRINGCACHE_H
+
+#include "python-module.h"
+
+#include <unordered_map>
+#include <vector>
+
+//! per-program cache of interned strings for value conversions; all functions must be called with the GIL held
+/** Python strings created for hash keys and short string values are interned and reused, so converting many hashes
+    with the same keys creates each key string only once, and the string's cached hash is reused when the key is
+    inserted in a dictionary; short interned Python strings are converted to shared %Qore strings.  Both tables are
+    cleared when they reach their maximum size.
+
+    The cache belongs to the program and not to the interpreter, so programs in a shared interpreter each have their
+    own tables.
+*/
+class QorePythonStringCache {
+public:
+    //! the maximum length in bytes of hash keys cached
+    static constexpr size_t MAX_KEY_LEN = 64;
+    //! the maximum length in bytes of string values cached
+    static constexpr size_t MAX_VALUE_LEN = 16;
+    //! the maximum number of strings in each table
+    static constexpr size_t MAX_ENTRIES = 4096;
+    //! the initial size of the Python string table; the table grows by powers of two up to MAX_ENTRIES * 2
+    static constexpr size_t MIN_TABLE_SIZE = 64;
+
+    DLLLOCAL QorePythonStringCache() {
+    }
+
+    QorePythonStringCache(const QorePythonStringCache&) = delete;
+    QorePythonStringCache& operator=(const QorePythonStringCache&) = delete;
+
+    //! returns a new reference to an interned Python string for the given UTF-8 string
+    /** @return nullptr if the string could not be created (Python exception raised)
+    */
+    DLLLOCAL PyObject* getPythonString(const char* str, size_t len);
+
+    //! returns a referenced Qore string for the given interned Python string
+    /** @param val the Python string; must be interned
+        @param str the UTF-8 representation of the string
+        @param len the length of \a str in bytes
+    */
+    DLLLOCAL QoreStringNode* getQoreString(PyObject* val, const char* str, size_t len);
+
+    //! releases all references
+    DLLLOCAL void purge();
+
+    //! discards all references without releasing them; used when the interpreter no longer exists
+    DLLLOCAL void abandon();
+
+private:
+    //! Python string table entry; an empty entry has obj == nullptr
+    struct py_entry_t {
+        //! a strong reference to the interned string
+        PyObject* obj;
+        //! the UTF-8 representation cached in the string object
+        const char* str;
+        size_t len;
+        size_t hash;
+    };
+    typedef std::vector<py_entry_t> py_table_t;
+    //! open-addressing table of Python strings; the size is always zero or a power of two
+    py_table_t py_table;
+    size_t py_count = 0;
+
+    //! maps interned Python strings to Qore strings; both keys and values are strong references
+    typedef std::unordered_map<PyObject*, QoreStringNode*> qore_map_t;
+    qore_map_t qore_map;
+
+    //! doubles the size of the Python string table and rehashes all entries
+    DLLLOCAL void growPython();
+
+    //! releases all Python string references
+    DLLLOCAL void purgePython();
+
+    //! releases all Qore string references
+    DLLLOCAL void purgeQore();
+};
+
+#endif
@@ -60,6 +60,8 @@ public:
 private:
     bool attached;
 
+    // NOTE: QFT_REGISTERED is not cached, as the existing registration may belong to a scoped helper that
+    // deregisters the thread later; the registration check is repeated on each call instead
     DLLLOCAL void attachIntern() {
         assert(!attached);
         int rc = q_register_foreign_thread();
@@ -101,4 +103,14 @@ private:
 
 extern thread_local QoreThreadAttacher qoreThreadAttacher;
 
+//! ensures that the current thread is registered with Qore
+/** foreign threads are registered on first use and remain registered until the thread exits, at which point the
+    thread-local attacher deregisters them; this avoids registering and deregistering the thread on every call
+*/
+DLLLOCAL static inline void q_attach_thread_to_qore() {
+    if (!qoreThreadAttacher) {
+        qoreThreadAttacher.attach();
+    }
+}
+
 #endif
\ No newline at end of file
@@ -23,6 +23,9 @@
 #include "QC_PythonProgram.h"
 #include "QorePythonProgram.h"
 #include "QorePythonStackLocationHelper.h"
+#include "QoreModuleCodeCache.h"
+#include "QorePythonReaper.h"
+#include "QorePythonFork.h"
 
 static QoreStringNode* python_module_init();
 static void python_module_ns_init(QoreNamespace* rns, QoreNamespace* qns);
@@ -69,6 +72,8 @@ static void py_mc_parse(ExceptionSink* xsink, QoreString& arg, QorePythonProgram
 static void py_mc_export_class(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
 static void py_mc_export_func(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
 static void py_mc_add_module_path(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
+static void py_mc_gil_telemetry(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
+static void py_mc_sample_profiler(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
 //static void py_mc_reset_python(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm);
 
 struct qore_python_cmd_info_t {
@@ -90,6 +95,8 @@ static mcmap_t mcmap = {
     {"export-class", qore_python_cmd_info_t(py_mc_export_class, true)},
     {"export-func", qore_python_cmd_info_t(py_mc_export_func, true)},
     {"add-module-path", qore_python_cmd_info_t(py_mc_add_module_path, true)},
+    {"gil-telemetry", qore_python_cmd_info_t(py_mc_gil_telemetry, true)},
+    {"sample-profiler", qore_python_cmd_info_t(py_mc_sample_profiler, true)},
 #if 0
     {"reset-python", qore_python_cmd_info_t(py_mc_reset_python, false)},
 #endif
@@ -284,13 +291,18 @@ static QoreStringNode* python_module_init_intern(bool repeat) {
 
         python_u_tld_key = q_get_unique_thread_local_data_key();
         python_qobj_key = q_get_unique_thread_local_data_key();
+
+        QorePythonCodeCache::initFromEnvironment();
+        QoreModuleCodeCache::initFromEnvironment();
+        QorePythonReaper::initFromEnvironment();
+        QorePythonFork::initFromEnvironment();
     }
 
     // ensure that runtime version matches compiled version
     check_python_version();
 
     if (init_global_qore_python_pgm() || QorePythonProgram::staticInit()
-        || QorePythonStackLocationHelper::staticInit()) {
+        || QorePythonStackLocationHelper::staticInit() || QorePythonFork::registerInterpreter(nullptr, nullptr)) {
         throw QoreStandardException("PYTHON-MODULE-ERROR", "failed to initialize \"python\" module");
     }
 
@@ -324,12 +336,15 @@ static void python_module_ns_init(QoreNamespace* rns, QoreNamespace* qns) {
             pgm->setExternalData(QORE_PYTHON_MODULE_NAME, new QorePythonProgram(pgm, pyns));
         }
     }
+    // the root namespace has changed; previous failed lookups may succeed now
+    QorePythonProgram::invalidateImportCaches();
 
     assert(!python_initialized || !PyGILState_Check());
     assert(!python_initialized || !QorePythonProgram::haveGil());
 }
 
 static void python_module_delete() {
+    QorePythonSampler::stop();
     if (qore_python_pgm) {
         qore_python_pgm->doDeref();
         qore_python_pgm = nullptr;
@@ -338,6 +353,9 @@ static void python_module_delete() {
         delete PNS;
         PNS = nullptr;
     }
+    // finalize any interpreters queued for asynchronous teardown before shutting down Python
+    QorePythonReaper::stop();
+    QorePythonProgram::staticCleanup();
     python_module_shutdown();
 }
 
@@ -395,6 +413,8 @@ static void python_module_parse_cmd(const QoreString& cmd, ExceptionSink* xsink)
     }
 
     i->second.cmd(xsink, arg, pypgm);
+    // module commands can load Qore modules and add namespaces
+    QorePythonProgram::invalidateImportCaches();
 }
 
 // %module-cmd(python) import
@@ -476,7 +496,7 @@ static void py_mc_parse(ExceptionSink* xsink, QoreString& arg, QorePythonProgram
     QoreString source_label(&arg, end);
     QoreString source_code(arg.c_str() + end + 1);
 
-    ValueHolder val(pypgm->eval(xsink, source_code, source_label, Py_file_input, false), xsink);
+    ValueHolder val(pypgm->eval(xsink, source_code, source_label, Py_file_input, false, true), xsink);
 }
 
 // %module-cmd(python) export-class <python path>
@@ -500,6 +520,48 @@ static void py_mc_add_module_path(ExceptionSink* xsink, QoreString& arg, QorePyt
     pypgm->addModulePath(xsink, arg);
 }
 
+// %module-cmd(python) gil-telemetry on|off|reset
+/** enable, disable, or reset process-wide GIL telemetry
+*/
+static void py_mc_gil_telemetry(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm) {
+    if (arg.equal("on")) {
+        QorePythonGilTelemetry::setEnabled(true);
+    } else if (arg.equal("off")) {
+        QorePythonGilTelemetry::setEnabled(false);
+    } else if (arg.equal("reset")) {
+        QorePythonGilTelemetry::reset();
+    } else {
+        xsink->raiseException("PYTHON-PARSE-COMMAND-ERROR", "invalid argument to gil-telemetry '%s'; expecting 'on', "
+            "'off', or 'reset'", arg.c_str());
+    }
+}
+
+// %module-cmd(python) sample-profiler start [<interval ms>] | stop [<file>]
+/** start the sampling profiler or stop it and optionally write collapsed stacks to the given file
+*/
+static void py_mc_sample_profiler(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm) {
+    QoreString param;
+    qore_offset_t end = arg.find(' ');
+    if (end != -1) {
+        param = arg;
+        param.replace(0, end + 1, (const char*)nullptr);
+        param.trim();
+        arg.terminate(end);
+    }
+
+    if (arg.equal("start")) {
+        QorePythonSampler::start(xsink, param.empty() ? 10 : strtoll(param.c_str(), nullptr, 10));
+    } else if (arg.equal("stop")) {
+        QorePythonSampler::stop();
+        if (!param.empty()) {
+            QorePythonSampler::writeCollapsed(xsink, param.c_str());
+        }
+    } else {
+        xsink->raiseException("PYTHON-PARSE-COMMAND-ERROR", "invalid argument to sample-profiler '%s'; expecting "
+            "'start' or 'stop'", arg.c_str());
+    }
+}
+
 #if 0
 // %module-cmd(python) reset-python
 static void py_mc_reset_python(ExceptionSink* xsink, QoreString& arg, QorePythonProgram* pypgm) {
@@ -554,7 +616,17 @@ QorePythonGilHelper::QorePythonGilHelper(PyThreadState* new_thread_state)
     //    new_thread_state, release_gil, state, t_state);
     assert(new_thread_state);
     if (release_gil) {
+        bool stats_enabled = QorePythonStatistics::isEnabled();
+        bool telemetry_enabled = QorePythonGilTelemetry::isEnabled();
+        uint64_t gil_start = (stats_enabled || telemetry_enabled) ? q_python_now_ns() : 0;
         PyEval_AcquireThread(new_thread_state);
+        if (telemetry_enabled) {
+            QorePythonGilTelemetry::acquired(nullptr, gil_start);
+        }
+        if (stats_enabled) {
+            QorePythonStatistics::global.inc(QPS_GIL_ACQUISITIONS);
+            QorePythonStatistics::global.inc(QPS_GIL_WAIT_NS, q_python_now_ns() - gil_start);
+        }
         assert(PyThreadState_Get() == new_thread_state);
     } else {
         assert(t_state == _qore_PyCeval_GetThreadState());
@@ -582,6 +654,9 @@ QorePythonGilHelper::~QorePythonGilHelper() {
         PyThreadState_Swap(new_thread_state);
         _qore_PyCeval_SwapThreadState(new_thread_state);
         _qore_PyGILState_SetThisThreadState(new_thread_state);
+        if (QorePythonGilTelemetry::isEnabled()) {
+            QorePythonGilTelemetry::released(nullptr);
+        }
         // release the GIL
         PyEval_ReleaseThread(new_thread_state);
     } else {
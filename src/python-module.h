@@ -30,6 +30,8 @@
 
 #include <qore/Qore.h>
 
+#include "QorePythonGilTelemetry.h"
+
 //! the name of the module
 #define QORE_PYTHON_MODULE_NAME "python"
 //! the name of the main Python namespace in Qore
@@ -118,11 +120,19 @@ protected:
 
 class QorePythonReleaseGilHelper {
 public:
-    DLLLOCAL QorePythonReleaseGilHelper() : _save(PyEval_SaveThread()) {
+    DLLLOCAL QorePythonReleaseGilHelper() {
+        if (QorePythonGilTelemetry::isEnabled()) {
+            QorePythonGilTelemetry::released(nullptr);
+        }
+        _save = PyEval_SaveThread();
     }
 
     DLLLOCAL ~QorePythonReleaseGilHelper() {
+        uint64_t gil_start = QorePythonGilTelemetry::start();
         PyEval_RestoreThread(_save);
+        if (gil_start) {
+            QorePythonGilTelemetry::acquired(nullptr, gil_start);
+        }
     }
 
 private:
@@ -24,8 +24,10 @@
 #include "QoreLoader.h"
 #include "JavaLoader.h"
 #include "QoreMetaPathFinder.h"
+#include "QoreModuleCodeCache.h"
 #include "QorePythonProgram.h"
 #include "PythonQoreCallable.h"
+#include "PythonQoreClass.h"
 
 #include <dlfcn.h>
 
@@ -212,7 +214,7 @@ static int slot_qoreloader_exec(PyObject *m) {
 
         init_global_qore_python_pgm();
 
-        if (PyType_Ready(&PythonQoreObjectBase_Type) < 0) {
+        if (PythonQoreClass::init()) {
             return -1;
         }
 
@@ -232,6 +234,10 @@ static int slot_qoreloader_exec(PyObject *m) {
             return -1;
         }
 
+        if (QoreModuleCodeCache::init()) {
+            return -1;
+        }
+
         if (qore_needs_shutdown) {
             printd(5, "slot_qoreloader_exec() PyThreadState_Get(): %p\n", PyThreadState_Get());
 
@@ -262,6 +268,7 @@ static int slot_qoreloader_exec(PyObject *m) {
     }
 
     QoreMetaPathFinder::setupModules();
+    QoreModuleCodeCache::setupModules();
 
     return 0;
 }
@@ -381,6 +388,7 @@ PyObject* qoreloader_load_java(PyObject* self, PyObject* args) {
     if (do_jni_module_import(qore_python_pgm, name_str)) {
         return nullptr;
     }
+    QorePythonProgram::invalidateImportCaches();
     //printd(5, "qoreloader_load_java() jni module loaded: import '%s' pgm: %p\n", name_str, qpgm);
 
     Py_INCREF(Py_None);
@@ -413,6 +421,8 @@ PyObject* qoreloader_issue_module_cmd(PyObject* self, PyObject* args) {
     ExceptionSink xsink;
     QorePythonProgram* qore_python_pgm = QorePythonProgram::getContext();
     QoreProgram* qpgm = qore_python_pgm->getQoreProgram();
+    // module commands can load Qore modules
+    QorePythonProgram::invalidateImportCaches();
     if (qpgm->issueModuleCmd(module_str, cmd_str, &xsink)) {
         assert(xsink);
         qore_python_pgm->raisePythonException(xsink);